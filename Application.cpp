@@ -5,6 +5,8 @@
 #include "classes/Othello.h"
 #include "classes/Connect4.h"
 #include "classes/Chess.h"
+#include <algorithm>
+#include <thread>
 
 namespace ClassGame {
         //
@@ -76,6 +78,10 @@ namespace ClassGame {
                         ImGui::Text("%s", stateString.substr(y*stride,stride).c_str());
                     }
                     ImGui::Text("Current Board State: %s", game->stateString().c_str());
+                    if (game->gameHasAI()) {
+                        int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+                        ImGui::SliderInt("AI Threads", &game->_gameOptions.AIThreads, 1, maxThreads);
+                    }
                 }
                 ImGui::End();
 
@@ -0,0 +1,345 @@
+//
+// bench - headless search benchmark
+//
+// runs the iterative deepening ChessSearch over a list of middlegame positions and reports
+// the best move, score, node counts, nodes per second and transposition table use.
+// like perft it builds only the engine pieces, no ImGui or GLFW.
+//
+// usage: bench [-d depth] [-t ms] [-n nodes] [--hash MB] [--threads N] [--smp] [--tactics] [--ablation] [--off a,b]
+//              [--sliders magic|pext] [--fen "<fen string>"]
+//   -d depth     deepest iteration, defaults to 5
+//   -t ms        time budget per position
+//   -n nodes     node budget per position
+//   --hash MB    transposition table budget, 0 turns it off
+//   --threads N  lazy SMP search threads, defaults to 1
+//   --smp        time the whole list to a fixed depth at 1, 2, 4 and 8 threads and report the speedup
+//   --tactics    run the tactical suite at a fixed time per position (-t, defaults to 1000 ms) and count the solves
+//   --ablation   run the list once as configured, then again with each search feature switched off on its own
+//   --off        switch search features off by name for A/B runs: pvs, aspiration, null, lmr, rfp, razor, futility, lmp,
+//                check, recapture, singular, seecaptures, seequiets
+//   --sliders    force the slider attack lookup instead of the one picked from CPUID
+//   --fen        run a single position instead of the built in list
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "classes/GameState.h"
+#include "classes/ChessSearch.h"
+#include "classes/MagicBitboards.h"
+
+struct BenchPosition {
+    const char* name;
+    const char* fen;
+};
+
+static const BenchPosition benchPositions[] = {
+    { "startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1" },
+    { "middle1", "r3k2r/2pb1ppp/2pp1q2/p7/1nP1B3/1P2P3/P2N1PPP/R2QK2R w KQkq a6 0 14" },
+    { "middle2", "4rrk1/2p1b1p1/p1p3q1/4p3/2P2n1p/1P1NR2P/PB3PP1/3R1QK1 b - - 2 24" },
+    { "middle3", "r3qbrk/6p1/2b2pPp/p3pP1Q/PpPpP2P/3P1B2/2PB3K/R5R1 w - - 16 42" },
+    { "middle4", "r1bq1rk1/pp2b1pp/n1pp1n2/3P1p2/2P1p3/2N1P2N/PP2BPPP/R1BQ1RK1 b - - 2 10" },
+    { "middle5", "7r/2p3k1/1p1p1qp1/1P1Bp3/p1P2r1P/P7/4R3/Q4RK1 w - - 0 36" },
+    { "endgame1", "6k1/1R3p2/6p1/2Bp3p/3P2q1/P7/1P2rQ1K/5R2 b - - 4 44" },
+    { "endgame2", "8/8/1p2k1p1/3p3p/1p1P1P1P/1P2PK2/8/8 w - - 3 54" },
+};
+
+// a few of the Win At Chess positions, the expected move is in from/to form
+struct TacticalPosition {
+    const char* name;
+    const char* fen;
+    const char* bestMove;
+};
+
+static const TacticalPosition tacticalPositions[] = {
+    { "WAC.001", "2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - 0 1", "g3g6" },
+    { "WAC.002", "8/7p/5k2/5p2/p1p2P2/Pr1pPK2/1P1R3P/8 b - - 0 1", "b3b2" },
+    { "WAC.003", "5rk1/1ppb3p/p1pb4/6q1/3P1p1r/2P1R2P/PP1BQ1P1/5RKN w - - 0 1", "e3g3" },
+    { "WAC.004", "r1bq2rk/pp3pbp/2p1p1pQ/7P/3P4/2PB1N2/PP3PPR/2KR4 w - - 0 1", "h6h7" },
+    { "WAC.005", "5k2/6pp/p1qN4/1p1p4/3P4/2PKP2Q/PP3r2/3R4 b - - 0 1", "c6c4" },
+    { "WAC.006", "7k/p7/1R5K/6r1/6p1/6P1/8/8 w - - 0 1", "b6b7" },
+    { "WAC.007", "rnbqkb1r/pppp1ppp/8/4P3/6n1/7P/PPPNPPP1/R1BQKBNR b KQkq - 0 1", "g4e3" },
+    { "WAC.008", "r4q1k/p2bR1rp/2p2Q1N/5p2/5p2/2P5/PP3PPP/R5K1 w - - 0 1", "e7f7" },
+    { "WAC.009", "3q1rk1/p4pp1/2pb3p/3p4/6Pr/1PNQ4/P1PB1PP1/4RRK1 b - - 0 1", "d6h2" },
+    { "WAC.010", "2br2k1/2q3rn/p2NppQ1/2p1P3/Pp5R/4P3/1P3PPP/3R2K1 w - - 0 1", "h4h7" },
+};
+
+// the SearchParams switches --off knows about
+struct SearchSwitch {
+    const char* name;
+    bool SearchParams::*enabled;
+};
+
+static const SearchSwitch searchSwitches[] = {
+    { "pvs", &SearchParams::pvs },
+    { "aspiration", &SearchParams::aspiration },
+    { "null", &SearchParams::nullMove },
+    { "lmr", &SearchParams::lmr },
+    { "rfp", &SearchParams::reverseFutility },
+    { "razor", &SearchParams::razoring },
+    { "futility", &SearchParams::futility },
+    { "lmp", &SearchParams::lateMovePruning },
+    { "check", &SearchParams::checkExtension },
+    { "recapture", &SearchParams::recaptureExtension },
+    { "singular", &SearchParams::singularExtension },
+    { "seecaptures", &SearchParams::seeCaptures },
+    { "seequiets", &SearchParams::seeQuiets },
+};
+
+// turns off every feature in a comma separated list, false if one of the names isn't known
+static bool switchOff(SearchParams& params, const char* names)
+{
+    std::string list = names;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        const std::string name = list.substr(start, end - start);
+        bool found = false;
+        for (const auto& feature : searchSwitches) {
+            if (name == feature.name) {
+                params.*feature.enabled = false;
+                found = true;
+            }
+        }
+        if (!found) {
+            printf("unknown search feature \"%s\"\n", name.c_str());
+            return false;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+// --sliders, false if the name isn't known or this CPU can't run pext
+static bool forceSliderBackend(const char* name)
+{
+    if (strcmp(name, "magic") == 0) {
+        return setSliderBackend(SliderMagic);
+    }
+    if (strcmp(name, "pext") == 0 && setSliderBackend(SliderPext)) {
+        return true;
+    }
+    printf("can't use \"%s\" sliders here, pick magic or pext on a CPU with bmi2\n", name);
+    return false;
+}
+
+static std::string squareName(int square)
+{
+    std::string name;
+    name += (char)('a' + (square & 7));
+    name += (char)('1' + (square >> 3));
+    return name;
+}
+
+static std::string moveName(const BitMove& move)
+{
+    std::string name = squareName(move.from) + squareName(move.to);
+    if (move.flags & IsPromotion) {
+        name += " pnbrqk"[move.promotion()];
+    }
+    return name;
+}
+
+// searches every position and returns the wall clock time, printing a line per position when verbose
+static double runPositions(ChessSearch& search, const std::vector<BenchPosition>& positions, const SearchLimits& limits,
+                           SearchStats& total, bool verbose)
+{
+    double totalSeconds = 0.0;
+    for (const auto& position : positions) {
+        GameState state;
+        if (!state.initFromFEN(position.fen)) {
+            printf("%s: could not parse FEN \"%s\"\n", position.name, position.fen);
+            continue;
+        }
+        // every position starts from an empty table so the numbers don't depend on the order
+        search.clear();
+
+        auto start = std::chrono::steady_clock::now();
+        SearchResult result = search.search(state, limits);
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+
+        const SearchStats& stats = search.stats();
+        if (verbose) {
+            printf("%-9s depth %2d best %-6s score %6d  %10llu nodes  %7.3f s  %9.0f nps  tt hits %5.1f%%  cutoffs %llu  hashfull %d\n",
+                   position.name, result.depth, result.found ? moveName(result.bestMove).c_str() : "none", result.score,
+                   (unsigned long long)stats.nodes, seconds, seconds > 0.0 ? stats.nodes / seconds : 0.0,
+                   stats.ttHitRate() * 100.0, (unsigned long long)stats.ttCutoffs, search.hashfull());
+            if (search.threads() > 1) {
+                for (int i = 0; i < (int)search.threadStats().size(); i++) {
+                    printf("            thread %d  %10llu nodes  %9.0f nps\n", i, (unsigned long long)search.threadStats()[i].nodes,
+                           seconds > 0.0 ? search.threadStats()[i].nodes / seconds : 0.0);
+                }
+            }
+        }
+
+        total.add(stats);
+        totalSeconds += seconds;
+    }
+    return totalSeconds;
+}
+
+int main(int argc, char** argv)
+{
+    SearchLimits limits;
+    limits.maxDepth = 5;
+    int hashMB = DEFAULT_HASH_MB;
+    int threads = 1;
+    bool smp = false;
+    bool tactics = false;
+    bool ablation = false;
+    SearchParams params;
+    const char* fen = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            limits.maxDepth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            limits.timeMs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            limits.nodes = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc) {
+            hashMB = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--smp") == 0) {
+            smp = true;
+        } else if (strcmp(argv[i], "--tactics") == 0) {
+            tactics = true;
+        } else if (strcmp(argv[i], "--ablation") == 0) {
+            ablation = true;
+        } else if (strcmp(argv[i], "--off") == 0 && i + 1 < argc) {
+            if (!switchOff(params, argv[++i])) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--sliders") == 0 && i + 1 < argc) {
+            if (!forceSliderBackend(argv[++i])) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--fen") == 0 && i + 1 < argc) {
+            fen = argv[++i];
+        } else {
+            printf("usage: %s [-d depth] [-t ms] [-n nodes] [--hash MB] [--threads N] [--smp] [--tactics] [--ablation] [--off a,b] [--sliders magic|pext] [--fen \"<fen string>\"]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (limits.maxDepth < 1 || limits.maxDepth >= MAX_DEPTH) {
+        printf("depth must be between 1 and %d\n", MAX_DEPTH - 1);
+        return 1;
+    }
+
+    std::vector<BenchPosition> positions;
+    if (fen) {
+        positions.push_back({ "fen", fen });
+    } else {
+        positions.assign(std::begin(benchPositions), std::end(benchPositions));
+    }
+
+    ChessSearch search;
+    search.setHashSize(hashMB);
+    search.setParams(params);
+
+    if (smp) {
+        // time to depth is what matters for lazy SMP, raw nps alone flatters it
+        printf("time to depth %d, hash %d MB, %u hardware threads\n", limits.maxDepth, search.hashSizeMB(),
+               std::thread::hardware_concurrency());
+        limits.timeMs = 0;
+        limits.nodes = 0;
+        double baseSeconds = 0.0;
+        for (int n : { 1, 2, 4, 8 }) {
+            search.setThreads(n);
+            SearchStats total;
+            double seconds = runPositions(search, positions, limits, total, false);
+            if (n == 1) {
+                baseSeconds = seconds;
+            }
+            printf("threads %d  %12llu nodes  %8.3f s  %10.0f nps  %7.0f nps/thread  speedup %.2fx\n", n,
+                   (unsigned long long)total.nodes, seconds, seconds > 0.0 ? total.nodes / seconds : 0.0,
+                   seconds > 0.0 ? total.nodes / seconds / n : 0.0, seconds > 0.0 ? baseSeconds / seconds : 0.0);
+        }
+        return 0;
+    }
+
+    search.setThreads(threads);
+
+    if (tactics) {
+        // fixed time is the fair way to compare, a deeper but slower search shouldn't get extra credit
+        SearchLimits tacticalLimits;
+        tacticalLimits.timeMs = limits.timeMs ? limits.timeMs : 1000;
+        printf("tactical suite, %d ms per position, hash %d MB, threads %d\n", tacticalLimits.timeMs,
+               search.hashSizeMB(), search.threads());
+        int solved = 0;
+        SearchStats total;
+        for (const auto& position : tacticalPositions) {
+            GameState state;
+            if (!state.initFromFEN(position.fen)) {
+                printf("%s: could not parse FEN \"%s\"\n", position.name, position.fen);
+                continue;
+            }
+            search.clear();
+            SearchResult result = search.search(state, tacticalLimits);
+            std::string found = result.found ? moveName(result.bestMove) : "none";
+            bool ok = found == position.bestMove;
+            solved += ok;
+            total.nodes += search.stats().nodes;
+            printf("%-8s depth %2d best %-6s expected %-6s %s  %10llu nodes\n", position.name, result.depth, found.c_str(),
+                   position.bestMove, ok ? "ok" : "--", (unsigned long long)search.stats().nodes);
+        }
+        printf("\nsolved %d of %d, %llu nodes\n", solved, (int)std::size(tacticalPositions), (unsigned long long)total.nodes);
+        return 0;
+    }
+
+    if (ablation) {
+        // what each feature is worth, in nodes and in time, against the configuration as given
+        printf("ablation, depth %d, time %d ms, nodes %llu, hash %d MB, threads %d\n", limits.maxDepth, limits.timeMs,
+               (unsigned long long)limits.nodes, search.hashSizeMB(), search.threads());
+        SearchStats baseTotal;
+        double baseSeconds = runPositions(search, positions, limits, baseTotal, false);
+        printf("%-15s %12llu nodes  %8.3f s\n", "all on", (unsigned long long)baseTotal.nodes, baseSeconds);
+        for (const auto& feature : searchSwitches) {
+            if (!(params.*feature.enabled)) {
+                continue;
+            }
+            SearchParams without = params;
+            without.*feature.enabled = false;
+            search.setParams(without);
+            SearchStats total;
+            double seconds = runPositions(search, positions, limits, total, false);
+            printf("%-15s %12llu nodes  %8.3f s  nodes x%.2f  time x%.2f\n", (std::string("no ") + feature.name).c_str(),
+                   (unsigned long long)total.nodes, seconds, baseTotal.nodes ? (double)total.nodes / baseTotal.nodes : 0.0,
+                   baseSeconds > 0.0 ? seconds / baseSeconds : 0.0);
+        }
+        return 0;
+    }
+
+    printf("depth %d, time %d ms, nodes %llu, hash %d MB, threads %d, sliders %s\n", limits.maxDepth, limits.timeMs,
+           (unsigned long long)limits.nodes, search.hashSizeMB(), search.threads(), sliderBackend == SliderPext ? "pext" : "magic");
+
+    SearchStats total;
+    double totalSeconds = runPositions(search, positions, limits, total, true);
+
+    printf("\ntotal: %llu nodes (%.1f%% quiescence), %.3f s, %.0f nps, tt hits %.1f%%\n", (unsigned long long)total.nodes,
+           total.nodes ? total.qnodes * 100.0 / total.nodes : 0.0, totalSeconds,
+           totalSeconds > 0.0 ? total.nodes / totalSeconds : 0.0, total.ttHitRate() * 100.0);
+    printf("null move: %llu tried, %llu cut off   lmr: %llu reduced, %llu re-searched\n",
+           (unsigned long long)total.nullMoveTries, (unsigned long long)total.nullMoveCutoffs,
+           (unsigned long long)total.lmrReductions, (unsigned long long)total.lmrResearches);
+    printf("reverse futility: %llu cut off   razoring: %llu tried, %llu cut off, %llu nodes   futility: %llu pruned   late moves: %llu pruned\n",
+           (unsigned long long)total.reverseFutilityCutoffs, (unsigned long long)total.razorTries,
+           (unsigned long long)total.razorCutoffs, (unsigned long long)total.razorNodes,
+           (unsigned long long)total.futilityPruned, (unsigned long long)total.lateMovePruned);
+    printf("extensions: %llu checks, %llu recaptures, %llu singular of %llu tried\n", (unsigned long long)total.checkExtensions,
+           (unsigned long long)total.recaptureExtensions, (unsigned long long)total.singularExtensions,
+           (unsigned long long)total.singularTries);
+    printf("see: %llu quiet moves pruned, %llu quiescence captures pruned\n", (unsigned long long)total.seeQuietsPruned,
+           (unsigned long long)total.seeCapturesPruned);
+    return 0;
+}
@@ -1,58 +1,15 @@
 #include "Chess.h"
-#include "ValueTable.h"
 #include <limits>
 #include <cmath>
-#include <array>
-
-static int actualPS[128][64];
-#define FLIP(x) (x^56)
-
-static const std::array<int, 128> evaluateScores = []() {
-    std::array<int, 128> scores {};
-    scores['P'] = 100; scores['p'] = -100;
-    scores['N'] = 300; scores['n'] = -300;
-    scores['B'] = 300; scores['b'] = -300;
-    scores['R'] = 500; scores['r'] = -500;
-    scores['Q'] = 900; scores['q'] = -900;
-    scores['K'] = 2000; scores['k'] = -2000;
-    scores['0'] = 0;
-    return scores;
-} ();
-
-static const std::array<int *, 128> ValueTables = []() {
-    std::array<int *, 128> pieceValues{};
-    pieceValues['P'] = (int* )&pawnTableW;      pieceValues['p'] = (int* )&pawnTableB;
-    pieceValues['N'] = (int* )&knightTableW;    pieceValues['n'] = (int* )&knightTableB;
-    pieceValues['B'] = (int* )&bishopTableW;    pieceValues['b'] = (int* )&bishopTableB;
-    pieceValues['R'] = (int* )&rookTableW;      pieceValues['r'] = (int* )&rookTableB;
-    pieceValues['Q'] = (int* )&queenTableW;     pieceValues['q'] = (int* )&queenTableB;
-    pieceValues['K'] = (int* )&kingTableW;      pieceValues['k'] = (int* )&kingTableB;
-    pieceValues['0'] = (int* )&emptyTable;
-    return pieceValues;
-} ();
 
 Chess::Chess()
 {
     _grid = new Grid(8, 8);
-
-    
-    std::memset(actualPS, 0, sizeof(actualPS));
-    const char pieces[] = {'P', 'N', 'B', 'R', 'Q', 'K'};
-    for (int p = 0; p < 6; p++) {
-        int score = evaluateScores[pieces[p]];
-        for (int sq = 0; sq < 64; sq++) {
-            int finalW = ValueTables[pieces[p]][sq] + score;
-            int finalB = ValueTables[tolower(pieces[p])][sq] - score;
-            actualPS[p + WHITE_PAWNS][sq] = finalW;
-            actualPS[p + BLACK_PAWNS][sq] = finalB;
-            actualPS[pieces[p]][sq] = finalW;
-            actualPS[tolower(pieces[p])][sq] = finalB;
-        }
-    }
 }
 
 Chess::~Chess()
 {
+    cancelAI();
     delete _grid;
 }
 
@@ -87,12 +44,15 @@ void Chess::setUpBoard()
     setNumberOfPlayers(2);
     _gameOptions.rowX = 8;
     _gameOptions.rowY = 8;
+    _gameOptions.AIMAXDepth = 12;
+    _gameOptions.AITimeLimitMs = 1000;
+    _gameOptions.AINodeLimit = 0;
 
     _grid->initializeChessSquares(pieceSize, "boardsquare.png");
     FENtoBoard("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR");
     _currentPlayer = WHITE;
-    _gameState.init( stateString().c_str(), _currentPlayer);
-    _moves = _gameState.generateAllMoves();
+    _gameState.init( stateString().c_str(), _currentPlayer, AllCastling);
+    _gameState.generateAllMoves(_moves);
 
     if (gameHasAI()) {
         setAIPlayer(AI_PLAYER);
@@ -152,6 +112,8 @@ bool Chess::actionForEmptyHolder(BitHolder &holder)
 
 bool Chess::canBitMoveFrom(Bit &bit, BitHolder &src)
 {
+    // the board belongs to the AI while it's thinking
+    if (aiThinking()) return false;
     int currentPlayer = getCurrentPlayer()->playerNumber() * 128;
     int pieceColor = bit.gameTag() & 128;
     if (pieceColor != currentPlayer) return false;
@@ -196,15 +158,58 @@ void Chess::clearBoardHighlights() {
 
 void Chess::bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst)
 {
-    _currentPlayer = (_currentPlayer == WHITE ? BLACK : WHITE);
-    _gameState.init(stateString().c_str(), _currentPlayer);
-    _moves = _gameState.generateAllMoves();
+    // find the legal move the drag made, a pawn reaching the last rank gets the queen which is listed first
+    int fromIndex = ((ChessSquare&)src).getSquareIndex();
+    int toIndex = ((ChessSquare&)dst).getSquareIndex();
+    for (auto move : _moves) {
+        if (move.from == fromIndex && move.to == toIndex) {
+            finishMove(move);
+            return;
+        }
+    }
+}
+
+void Chess::moveBitBetween(int fromSquare, int toSquare)
+{
+    ChessSquare* from = _grid->getSquareByIndex(fromSquare);
+    ChessSquare* to = _grid->getSquareByIndex(toSquare);
+    Bit* bit = from->bit();
+    to->dropBitAtPoint(bit, ImVec2(0, 0));
+    from->setBit(nullptr);
+}
+
+void Chess::finishMove(const BitMove& move)
+{
+    const int playerNumber = (_currentPlayer == WHITE) ? 0 : 1;
+
+    // the rook, the pawn taken en passant and the promoted piece aren't part of the drag
+    if (move.flags & KingSideCastle) {
+        moveBitBetween(move.to + 1, move.to - 1);
+    } else if (move.flags & QueenSideCastle) {
+        moveBitBetween(move.to - 2, move.to + 1);
+    } else if (move.flags & EnPassant) {
+        _grid->getSquareByIndex(_currentPlayer == WHITE ? move.to - 8 : move.to + 8)->destroyBit();
+    } else if (move.flags & IsPromotion) {
+        ChessSquare* square = _grid->getSquareByIndex(move.to);
+        ChessPiece piece = move.promotion();
+        Bit* bit = PieceForPlayer(playerNumber, piece);
+        bit->setPosition(square->getPosition());
+        bit->setParent(square);
+        bit->setGameTag(playerNumber == 0 ? piece : piece + 128);
+        square->setBit(bit);
+    }
+
+    // play the move on the game state too so castling and en passant rights carry over
+    _gameState.playMove(move);
+    _currentPlayer = _gameState.color;
+    _gameState.generateAllMoves(_moves);
     clearBoardHighlights();
     endTurn();
 }
 
 void Chess::stopGame()
 {
+    cancelAI();
     _grid->forEachSquare([](ChessSquare* square, int x, int y) {
         square->destroyBit();
     });
@@ -263,69 +268,61 @@ void Chess::setStateString(const std::string &s)
 
 void Chess::updateAI() {
 
-
-    int bestVal = negInfinite;
-    BitMove bestMove;
-
-    for (const auto& move : _moves) {
-        
-        _gameState.pushMove(move);
-
-        int moveVal = -negamax(_gameState, 5, negInfinite, posInfinite);
-
-        _gameState.popState();
-
-        if (moveVal > bestVal) {
-            bestMove = move;
-            bestVal = moveVal;
-        }
+    // mated or stalemated, there's nothing to search for
+    if (!_aiSearch.valid() && _moves.empty()) {
+        return;
+    }
+    if (!_aiSearch.valid()) {
+        SearchLimits limits;
+        limits.maxDepth = _gameOptions.AIMAXDepth;
+        limits.timeMs = _gameOptions.AITimeLimitMs;
+        limits.nodes = _gameOptions.AINodeLimit;
+        _search.setThreads(_gameOptions.AIThreads);
+        _aiStart = std::chrono::steady_clock::now();
+        // the worker gets its own copy of the board so the UI thread never shares one with it
+        _aiSearch = std::async(std::launch::async, [this, limits, state = _gameState]() mutable {
+            return _search.search(state, limits);
+        });
+        return;
     }
 
-    if (bestVal != negInfinite) {
-        int fromSquare = bestMove.from;
-        int toSquare = bestMove.to;
-        BitHolder& from = getHolderAt(fromSquare & 7, fromSquare / 8);
-        BitHolder& to = getHolderAt(toSquare & 7, toSquare / 8);
-        Bit* bit = from.bit();
-        to.dropBitAtPoint(bit, ImVec2(0, 0));
-        from.setBit(nullptr);
-        bitMovedFromTo(*bit, from, to);
+    // keep drawing frames until the worker is done
+    if (_aiSearch.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
     }
+    SearchResult result = _aiSearch.get();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _aiStart).count();
+    applyAIResult(result, seconds);
 }
 
-int Chess::negamax(GameState& gameState, int depth, int alpha, int beta) {
-
-    if (depth == 0) {
-        return evaluateBoard(gameState);
+void Chess::cancelAI() {
+    if (!_aiSearch.valid()) {
+        return;
     }
-
-    auto newMoves = gameState.generateAllMoves();
-
-    int bestVal = negInfinite; 
-
-    for(const auto& move : newMoves) {
-
-        gameState.pushMove(move);
-
-        bestVal = std::max(bestVal, -negamax(gameState, depth - 1, -beta, -alpha));
-
-        gameState.popState();
-
-        alpha = std::max(alpha, bestVal);
-        if (alpha >= beta) {
-            break;
-        }
+    // keep asking, a worker that hasn't started searching yet would clear a single stop request
+    while (_aiSearch.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready) {
+        _search.stop();
     }
-    return bestVal;
+    _aiSearch.get();
 }
 
-int Chess::evaluateBoard(const GameState& gameState) {
-    int score = 0;
+void Chess::applyAIResult(const SearchResult& result, double seconds) {
 
-    for (int square = 0; square < 64; square++) {
-        const unsigned char piece = (gameState.state[square]);
-        score += actualPS[piece][square];
+    // a cancelled search or one with no move to play has nothing worth reporting
+    if (!result.found) {
+        return;
+    }
+    _gameOptions.AIDepthSearches = result.depth;
+
+    const SearchStats& stats = _search.stats();
+    std::cout << "AI reached depth " << result.depth << ", searched " << stats.nodes << " nodes, tt hit rate "
+              << (int)(stats.ttHitRate() * 100) << "%, hashfull " << _search.hashfull() << " permill" << std::endl;
+    if (_search.threads() > 1 && seconds > 0.0) {
+        for (int i = 0; i < (int)_search.threadStats().size(); i++) {
+            std::cout << "  thread " << i << ": " << (uint64_t)(_search.threadStats()[i].nodes / seconds) << " nps" << std::endl;
+        }
     }
 
-    return score * gameState.color;
-}   
\ No newline at end of file
+    moveBitBetween(result.bestMove.from, result.bestMove.to);
+    finishMove(result.bestMove);
+}
@@ -4,10 +4,9 @@
 #include "Grid.h"
 #include "Bitboard.h"
 #include "GameState.h"
+#include "ChessSearch.h"
 
 constexpr int pieceSize = 80;
-constexpr int negInfinite = -1000000;
-constexpr int posInfinite = 1000000;
 //columns
 constexpr uint64_t FILE_A = 0x0101010101010101ULL;
 constexpr uint64_t FILE_B = FILE_A << 1;
@@ -56,9 +55,18 @@ public:
     void setStateString(const std::string &s) override;
 
     Grid* getGrid() override { return _grid; }
+    // starts the search on a worker the first frame, applies its move on a later frame once it's done
     void updateAI();
     bool gameHasAI() override { return true; }
+    bool aiThinking() const { return _aiSearch.valid(); }
+    // stop a running search and throw its result away
+    void cancelAI();
 private:
+    void applyAIResult(const SearchResult& result, double seconds);
+    // the moved piece is already on its new square, this handles the rest of the move and ends the turn
+    void finishMove(const BitMove& move);
+    void moveBitBetween(int fromSquare, int toSquare);
+
     Bit* PieceForPlayer(const int playerNumber, ChessPiece piece);
     Player* ownerAt(int x, int y) const;
     void FENtoBoard(const std::string& fen);
@@ -68,11 +76,12 @@ private:
     int _currentPlayer = WHITE;
     int _countMoves = 0;
     GameState _gameState;
-    std::vector<BitMove> _moves;
+    ChessSearch _search;
+    std::future<SearchResult> _aiSearch;
+    std::chrono::steady_clock::time_point _aiStart;
+    MoveList _moves;
     BitBoard _knightBitBoards[64];
     BitBoard _kingBitBoards[64];
 
     void clearBoardHighlights();
-    int negamax(GameState& state, int depth, int alpha, int beta);
-    int evaluateBoard(const GameState&);
 };
\ No newline at end of file
@@ -0,0 +1,638 @@
+#include "ChessSearch.h"
+#include "MovePicker.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+// mate scores are stored relative to the node so they stay correct when the position is reached at another ply
+static int scoreToTT(int score, int ply)
+{
+    if (score >= MATE_BOUND) return score + ply;
+    if (score <= -MATE_BOUND) return score - ply;
+    return score;
+}
+
+static int scoreFromTT(int score, int ply)
+{
+    if (score >= MATE_BOUND) return score - ply;
+    if (score <= -MATE_BOUND) return score + ply;
+    return score;
+}
+
+// the same material values evaluateBoard uses, for delta pruning
+static const int materialValue[7] = { 0, 100, 300, 300, 500, 900, 0 };
+// a capture that can't lift the score to alpha even with this much positional slack is skipped
+constexpr int DELTA_MARGIN = 200;
+// per square our knights and sliders reach that isn't ours or covered by an enemy pawn
+constexpr int MOBILITY_WEIGHT = 2;
+// per square next to the enemy king that we attack
+constexpr int KING_ZONE_WEIGHT = 6;
+
+SearchResult ChessSearch::findBestMove(GameState& gameState, int depth)
+{
+    SearchLimits limits;
+    limits.maxDepth = depth;
+    return search(gameState, limits);
+}
+
+SearchResult ChessSearch::search(GameState& gameState, const SearchLimits& limits)
+{
+    _limits = limits;
+    _limits.maxDepth = std::clamp(limits.maxDepth, 1, MAX_DEPTH - 1);
+    _startTime = std::chrono::steady_clock::now();
+    _stop = false;
+    _tt.newSearch();
+
+    std::vector<std::unique_ptr<SearchThread>> workers;
+    for (int id = 0; id < _threads; id++) {
+        workers.push_back(std::make_unique<SearchThread>(*this, id, gameState));
+    }
+    // the helpers run on their own threads, the main worker on the caller's
+    std::vector<std::thread> helpers;
+    for (int id = 1; id < _threads; id++) {
+        helpers.emplace_back(&SearchThread::iterativeDeepening, workers[id].get());
+    }
+    workers[0]->iterativeDeepening();
+    // once the main worker is done the helpers have nothing left to contribute
+    _stop = true;
+    for (auto& helper : helpers) {
+        helper.join();
+    }
+
+    // take the deepest finished iteration, the main worker wins a tie
+    SearchResult result = workers[0]->result();
+    _stats = SearchStats();
+    _threadStats.clear();
+    for (const auto& worker : workers) {
+        if (worker->result().found && worker->result().depth > result.depth) {
+            result = worker->result();
+        }
+        _stats.add(worker->stats());
+        _threadStats.push_back(worker->stats());
+    }
+    return result;
+}
+
+SearchThread::SearchThread(ChessSearch& search, int id, const GameState& gameState)
+    : _search(search), _id(id), _gameState(gameState)
+{
+    _history.clear();
+    // the limits are checked every 1024 nodes, a small node budget gets checked often enough
+    // that it isn't overshot by more than a sixty-fourth
+    _pollMask = 1023;
+    const uint64_t budget = _search._limits.nodes / _search._threads;
+    while (budget && _pollMask && (uint64_t)(_pollMask + 1) * 64 > budget) {
+        _pollMask >>= 1;
+    }
+    std::fill(std::begin(_excludedMove), std::end(_excludedMove), 0);
+    std::fill(std::begin(_pathExtensions), std::end(_pathExtensions), 0);
+    const SearchParams& params = _search._params;
+    for (int depth = 0; depth < MAX_DEPTH; depth++) {
+        for (int moveNumber = 0; moveNumber < MAX_MOVES; moveNumber++) {
+            double reduction = 0.0;
+            if (depth > 0 && moveNumber > 0) {
+                reduction = params.lmrBase + std::log((double)depth) * std::log((double)moveNumber) / params.lmrDivisor;
+            }
+            _reductions[depth][moveNumber] = (uint8_t)std::clamp((int)reduction, 0, MAX_DEPTH);
+        }
+    }
+}
+
+template <int Color>
+void SearchThread::orderRootMoves(MoveList& rootMoves)
+{
+    MovePicker<Color> rootPicker(_gameState, 0, nullptr, 0, nullptr);
+    BitMove rootMove;
+    while (rootPicker.next(rootMove)) {
+        rootMoves.push_back(rootMove);
+    }
+}
+
+void SearchThread::iterativeDeepening()
+{
+    // every root move gets searched, so the picker orders the root list once and the iterations reorder it from there
+    const bool white = _gameState.color == WHITE;
+    MoveList rootMoves;
+    white ? orderRootMoves<WHITE>(rootMoves) : orderRootMoves<BLACK>(rootMoves);
+    // a limit can fire before the first iteration finishes, the best ordered move is still better than none.
+    // it stays at depth 0 with no score so the first real iteration replaces it
+    if (!rootMoves.empty()) {
+        _result.bestMove = rootMoves[0];
+        _result.found = true;
+    }
+
+    // odd helpers start one ply ahead so the threads don't all walk the same tree in lockstep
+    for (int depth = 1 + (_id & 1); depth <= _search._limits.maxDepth; depth++) {
+        BitMove bestMove;
+        int score = white ? aspirationSearch<WHITE>(rootMoves, depth, bestMove) : aspirationSearch<BLACK>(rootMoves, depth, bestMove);
+        // a half finished iteration can't be trusted, keep the last complete one
+        if (_search._stop) {
+            break;
+        }
+        if (score == negInfinite) {
+            break;
+        }
+        _result.bestMove = bestMove;
+        _result.score = score;
+        _result.depth = depth;
+        _result.found = true;
+
+        // the best move leads the next iteration
+        for (int i = 0; i < rootMoves.size(); i++) {
+            if (rootMoves[i] == bestMove) {
+                std::rotate(rootMoves.begin(), rootMoves.begin() + i, rootMoves.begin() + i + 1);
+                break;
+            }
+        }
+        // no point going deeper once a forced mate is on the board
+        if (score >= MATE_BOUND || score <= -MATE_BOUND) {
+            break;
+        }
+    }
+}
+
+template <int Color>
+int SearchThread::aspirationSearch(MoveList& rootMoves, int depth, BitMove& bestMove)
+{
+    const SearchParams& params = _search._params;
+    int delta = params.aspirationWindow;
+    int alpha = negInfinite;
+    int beta = posInfinite;
+    // the first iteration has nothing to centre on, and mate scores jump around too much for a window
+    if (params.aspiration && _result.found && std::abs(_result.score) < MATE_BOUND) {
+        alpha = std::max(_result.score - delta, negInfinite);
+        beta = std::min(_result.score + delta, posInfinite);
+    }
+
+    while (true) {
+        BitMove move;
+        int score = searchRoot<Color>(rootMoves, depth, alpha, beta, move);
+        if (_search._stop || score == negInfinite) {
+            return score;
+        }
+        if (score <= alpha && alpha > negInfinite) {
+            // failed low, every move is worse than we thought and none of them can be trusted as best
+            alpha = std::max(score - delta, negInfinite);
+        } else if (score >= beta && beta < posInfinite) {
+            // failed high, the move that did it is at least this good so it can stand in as best
+            bestMove = move;
+            beta = std::min(score + delta, posInfinite);
+        } else {
+            bestMove = move;
+            return score;
+        }
+        delta *= 2;
+    }
+}
+
+template <int Color>
+int SearchThread::searchRoot(MoveList& rootMoves, int depth, int alpha, int beta, BitMove& bestMove)
+{
+    constexpr int Them = -Color;
+    int bestVal = negInfinite;
+    bool first = true;
+
+    for (const auto& move : rootMoves) {
+
+        _currentMove[0] = move;
+        _pathExtensions[1] = 0;
+        _gameState.makeMove<Color>(move);
+
+        int moveVal;
+        if (first || !_search._params.pvs) {
+            moveVal = -negamax<Them>(depth - 1, 1, -beta, -alpha);
+        } else {
+            // the rest only have to show they can't beat the best so far, which a null window does cheaply
+            moveVal = -negamax<Them>(depth - 1, 1, -alpha - 1, -alpha);
+            if (moveVal > alpha && moveVal < beta) {
+                moveVal = -negamax<Them>(depth - 1, 1, -beta, -alpha);
+            }
+        }
+        first = false;
+
+        _gameState.unmakeMove<Color>(move);
+
+        if (_search._stop) {
+            return negInfinite;
+        }
+
+        if (moveVal > bestVal) {
+            bestMove = move;
+            bestVal = moveVal;
+        }
+        alpha = std::max(alpha, bestVal);
+        if (alpha >= beta) {
+            break;
+        }
+    }
+    return bestVal;
+}
+
+uint16_t* SearchThread::counterMoveSlot(int ply)
+{
+    if (ply == 0) {
+        return nullptr;
+    }
+    // the piece that just moved is sitting on its destination square. a null move has no piece
+    const BitMove& previous = _currentMove[ply - 1];
+    if (previous.piece == NoPiece) {
+        return nullptr;
+    }
+    const int piece = bitboardLookup[(unsigned char)_gameState.state[previous.to]];
+    return &_history.counterMoves[piece][previous.to];
+}
+
+template <int Color>
+bool SearchThread::hasNonPawnMaterial() const
+{
+    constexpr int us = Color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    return (_gameState._bitboards[WHITE_ALL_PIECES + us].getData() &
+            ~(_gameState._bitboards[WHITE_PAWNS + us].getData() | _gameState._bitboards[WHITE_KING + us].getData())) != 0;
+}
+
+void SearchThread::updateQuietHistory(const BitMove& move, const BitMove* triedQuiets, int triedCount, int depth, int ply)
+{
+    // a quiet move that refutes this position will likely refute its siblings too
+    if (!(_killers[ply][0] == move)) {
+        _killers[ply][1] = _killers[ply][0];
+        _killers[ply][0] = move;
+    }
+
+    // deeper cutoffs say more, but one lucky one shouldn't swamp the table
+    const int bonus = std::min(32 * depth * depth, MAX_HISTORY / 8);
+    // the board is back to this node, so the movers are still on their from squares
+    _history.update(bitboardLookup[(unsigned char)_gameState.state[move.from]], move.to, bonus);
+    for (int i = 0; i < triedCount; i++) {
+        const BitMove& tried = triedQuiets[i];
+        _history.update(bitboardLookup[(unsigned char)_gameState.state[tried.from]], tried.to, -bonus);
+    }
+}
+
+void SearchThread::checkLimits()
+{
+    // the node budget is split evenly, each thread only knows its own count
+    const SearchLimits& limits = _search._limits;
+    if (limits.nodes && _stats.nodes * _search._threads >= limits.nodes) {
+        _search._stop = true;
+    }
+    if (limits.timeMs) {
+        auto elapsed = std::chrono::steady_clock::now() - _search._startTime;
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() >= limits.timeMs) {
+            _search._stop = true;
+        }
+    }
+}
+
+template <int Color>
+int SearchThread::negamax(int depth, int ply, int alpha, int beta) {
+    constexpr int Them = -Color;
+    _stats.nodes++;
+    // the clock is only worth reading every so often
+    if ((_stats.nodes & _pollMask) == 0) {
+        checkLimits();
+    }
+    if (_search._stop) {
+        return 0;
+    }
+
+    if (depth == 0) {
+        return quiescence<Color>(ply, alpha, beta);
+    }
+    // extensions can carry a line past the stacks, the budget keeps this rare
+    if (ply >= MAX_PLY - 1) {
+        return _search.evaluateBoard(_gameState);
+    }
+
+    // a singular extension test searches this node again without the hash move. that search can't use or
+    // overwrite the entry for the full node, and it doesn't prune on the static eval either
+    const uint16_t excludedMove = _excludedMove[ply];
+
+    // a deep enough entry can answer for the whole subtree, otherwise its move goes first
+    const int alphaOrig = alpha;
+    uint16_t hashMove = 0;
+    TTEntry entry;
+    bool ttHit = false;
+    int ttScore = 0;
+    _stats.ttProbes++;
+    if (!excludedMove && _search._tt.probe(_gameState.hash(), entry)) {
+        _stats.ttHits++;
+        ttHit = true;
+        hashMove = entry.move16;
+        ttScore = scoreFromTT(entry.score, ply);
+        if (entry.depth >= depth) {
+            if (entry.bound() == BoundExact ||
+                (entry.bound() == BoundLower && ttScore >= beta) ||
+                (entry.bound() == BoundUpper && ttScore <= alpha)) {
+                _stats.ttCutoffs++;
+                return ttScore;
+            }
+        }
+    }
+
+    const SearchParams& params = _search._params;
+    const bool pvNode = beta - alpha > 1;
+    uint16_t* counterMove = counterMoveSlot(ply);
+    // the picker works out the checks up front but generates nothing until the first next()
+    MovePicker<Color> picker(_gameState, hashMove, _killers[ply], counterMove ? *counterMove : 0, &_history);
+    const bool inCheck = picker.inCheck();
+
+    // everything that prunes on the static eval stays off the PV and out of check
+    const bool canPrune = !pvNode && !inCheck && !excludedMove;
+    const int staticEval = canPrune ? _search.evaluateBoard(_gameState) : negInfinite;
+
+    // reverse futility, we're far enough above beta that the opponent isn't getting back in a few plies
+    if (canPrune && params.reverseFutility && depth <= params.reverseFutilityDepth && std::abs(beta) < MATE_BOUND &&
+        staticEval - params.reverseFutilityMargin * depth >= beta) {
+        _stats.reverseFutilityCutoffs++;
+        return staticEval;
+    }
+
+    // razoring, far enough below alpha that a quiet move won't save us. quiescence has the final say
+    if (canPrune && params.razoring && depth <= params.razoringDepth && staticEval + params.razoringMargin * depth <= alpha) {
+        _stats.razorTries++;
+        const uint64_t nodesBefore = _stats.nodes;
+        int razorVal = quiescence<Color>(ply, alpha, alpha + 1);
+        _stats.razorNodes += _stats.nodes - nodesBefore;
+        if (_search._stop) {
+            return 0;
+        }
+        if (razorVal <= alpha) {
+            _stats.razorCutoffs++;
+            return razorVal;
+        }
+    }
+
+    // null move pruning. if passing still leaves us at or above beta after a shallower search, some real move
+    // will as well. one pass in a row at most, and not with only pawns where passing may be the best move there is
+    if (canPrune && params.nullMove && depth >= params.nullMoveMinDepth && ply > 0 &&
+        _currentMove[ply - 1].piece != NoPiece && hasNonPawnMaterial<Color>() && staticEval >= beta) {
+        const int reduction = params.nullMoveReduction + depth / params.nullMoveDepthDivisor;
+        _stats.nullMoveTries++;
+        _currentMove[ply] = BitMove();
+        _pathExtensions[ply + 1] = _pathExtensions[ply];
+        _gameState.makeNullMove<Color>();
+        int nullVal = -negamax<Them>(std::max(depth - 1 - reduction, 0), ply + 1, -beta, -beta + 1);
+        _gameState.unmakeNullMove<Color>();
+        if (_search._stop) {
+            return 0;
+        }
+        if (nullVal >= beta) {
+            _stats.nullMoveCutoffs++;
+            // a mate found after passing isn't a proven one
+            return nullVal >= MATE_BOUND ? beta : nullVal;
+        }
+    }
+
+    int bestVal = negInfinite;
+    BitMove bestMove;
+    int moveCount = 0;
+    BitMove move;
+    // the quiet moves that didn't cut off, they lose history if a later one does
+    BitMove triedQuiets[MAX_MOVES];
+    int triedCount = 0;
+
+    const bool canExtend = _pathExtensions[ply] < params.extensionBudget;
+
+    while (picker.next(move)) {
+        if (excludedMove && packMove(move) == excludedMove) {
+            continue;
+        }
+        moveCount++;
+
+        const bool quiet = !(move.flags & (IsCapture | IsPromotion));
+        // quiet moves only get pruned once a searched move has shown we aren't being mated
+        const bool prunable = canPrune && quiet && bestVal > -MATE_BOUND;
+
+        // late move pruning, this far down a shallow node's ordering the rest of the quiet moves aren't worth a look
+        if (prunable && params.lateMovePruning && depth <= params.lateMoveDepth &&
+            moveCount > params.lateMoveBase + depth * depth) {
+            _stats.lateMovePruned++;
+            picker.skipQuiets();
+            continue;
+        }
+
+        // a quiet move that hangs material is rarely worth a search this close to the leaves
+        if (prunable && params.seeQuiets && depth <= params.seeQuietDepth &&
+            !_gameState.see(move, -params.seeQuietMargin * depth)) {
+            _stats.seeQuietsPruned++;
+            continue;
+        }
+
+        // singular extension, the hash move is the only move that holds up here. the others get a null window, half
+        // depth search against a bar a little under its stored score, and if none of them reach it the hash move
+        // is searched a ply deeper
+        int extension = 0;
+        if (canExtend && params.singularExtension && moveCount == 1 && ttHit && isPackedMove(hashMove, move) &&
+            depth >= params.singularMinDepth && entry.depth >= depth - 3 && entry.bound() != BoundUpper &&
+            std::abs(ttScore) < MATE_BOUND) {
+            const int singularBeta = ttScore - params.singularMargin * depth;
+            _stats.singularTries++;
+            _excludedMove[ply] = hashMove;
+            int singularVal = negamax<Color>((depth - 1) / 2, ply, singularBeta - 1, singularBeta);
+            _excludedMove[ply] = 0;
+            if (_search._stop) {
+                return 0;
+            }
+            if (singularVal < singularBeta) {
+                _stats.singularExtensions++;
+                extension = 1;
+            }
+        }
+
+        _currentMove[ply] = move;
+        _gameState.makeMove<Color>(move);
+
+        // whether the move gives check is only worked out when something depends on it
+        const bool futile = prunable && params.futility && depth <= params.futilityDepth &&
+                            staticEval + params.futilityMargin * depth <= alpha;
+        const bool reducible = params.lmr && quiet && !inCheck && depth >= params.lmrMinDepth && moveCount > params.lmrMinMoves;
+        const bool givesCheck = (futile || reducible || (canExtend && params.checkExtension)) && _gameState.isInCheck();
+
+        // futility pruning, a quiet move can't make up the gap to alpha unless it's a check
+        if (futile && !givesCheck) {
+            _gameState.unmakeMove<Color>(move);
+            _stats.futilityPruned++;
+            continue;
+        }
+
+        // checks and, on the PV, recaptures are forcing enough to see through to the end
+        if (canExtend && !extension) {
+            const BitMove& previous = _currentMove[ply - 1];
+            if (params.checkExtension && givesCheck) {
+                _stats.checkExtensions++;
+                extension = 1;
+            } else if (params.recaptureExtension && pvNode && (move.flags & IsCapture) &&
+                       (previous.flags & IsCapture) && previous.to == move.to) {
+                _stats.recaptureExtensions++;
+                extension = 1;
+            }
+        }
+        _pathExtensions[ply + 1] = _pathExtensions[ply] + extension;
+        const int newDepth = depth - 1 + extension;
+
+        // late move reductions, a quiet move this far down the list rarely beats alpha. a null window at
+        // reduced depth checks, and a move that beats it anyway is searched again normally.
+        // not when in check or giving check, those lines are too forcing to cut short
+        int reduction = 0;
+        if (reducible && !givesCheck) {
+            reduction = std::min<int>(_reductions[depth][std::min(moveCount, MAX_MOVES - 1)], depth - 1);
+        }
+
+        int moveVal = 0;
+        bool fullDepth = true;
+        if (reduction > 0) {
+            _stats.lmrReductions++;
+            moveVal = -negamax<Them>(newDepth - reduction, ply + 1, -alpha - 1, -alpha);
+            fullDepth = moveVal > alpha;
+            if (fullDepth) {
+                _stats.lmrResearches++;
+            }
+        }
+        if (fullDepth) {
+            if (moveCount == 1 || !params.pvs) {
+                moveVal = -negamax<Them>(newDepth, ply + 1, -beta, -alpha);
+            } else {
+                // principal variation search, the first move is expected to be best and the rest only get a null window.
+                // one that beats alpha anyway is searched again with the real one
+                moveVal = -negamax<Them>(newDepth, ply + 1, -alpha - 1, -alpha);
+                if (moveVal > alpha && moveVal < beta) {
+                    moveVal = -negamax<Them>(newDepth, ply + 1, -beta, -alpha);
+                }
+            }
+        }
+
+        _gameState.unmakeMove<Color>(move);
+
+        if (_search._stop) {
+            return 0;
+        }
+
+        if (moveVal > bestVal) {
+            bestVal = moveVal;
+            bestMove = move;
+        }
+
+        alpha = std::max(alpha, bestVal);
+        if (alpha >= beta) {
+            if (quiet) {
+                updateQuietHistory(move, triedQuiets, triedCount, depth, ply);
+                if (counterMove) {
+                    *counterMove = packMove(move);
+                }
+            }
+            break;
+        }
+        if (quiet) {
+            triedQuiets[triedCount++] = move;
+        }
+    }
+
+    if (moveCount == 0) {
+        // with the hash move left out an empty list only means it was the one legal move, as singular as it gets
+        if (excludedMove) {
+            return alpha;
+        }
+        // checkmate, or a stalemate which is a draw
+        return inCheck ? -MATE_SCORE + ply : 0;
+    }
+    if (excludedMove) {
+        return bestVal;
+    }
+
+    // a fail low has no best move worth remembering
+    int bound = bestVal >= beta ? BoundLower : (bestVal <= alphaOrig ? BoundUpper : BoundExact);
+    _search._tt.store(_gameState.hash(), bound == BoundUpper ? 0 : packMove(bestMove), scoreToTT(bestVal, ply), depth, bound);
+
+    return bestVal;
+}
+
+template <int Color>
+int SearchThread::quiescence(int ply, int alpha, int beta) {
+    constexpr int Them = -Color;
+    _stats.nodes++;
+    _stats.qnodes++;
+    if ((_stats.nodes & _pollMask) == 0) {
+        checkLimits();
+    }
+    if (_search._stop) {
+        return 0;
+    }
+
+    if (ply >= MAX_PLY - 1) {
+        return _search.evaluateBoard(_gameState);
+    }
+
+    // captures and queen promotions, or every evasion when in check
+    MovePicker<Color> picker(_gameState);
+    const bool inCheck = picker.inCheck();
+
+    // stand pat, the side to move can usually do at least as well as doing nothing. not when in check though
+    int bestVal = negInfinite;
+    int standPat = negInfinite;
+    if (!inCheck) {
+        standPat = _search.evaluateBoard(_gameState);
+        if (standPat >= beta) {
+            return standPat;
+        }
+        alpha = std::max(alpha, standPat);
+        bestVal = standPat;
+    }
+
+    int moveCount = 0;
+    BitMove move;
+    while (picker.next(move)) {
+        moveCount++;
+
+        // delta pruning, even winning the piece for free doesn't get us back to alpha
+        if (!inCheck && !(move.flags & IsPromotion) &&
+            standPat + materialValue[victimPiece(_gameState, move)] + DELTA_MARGIN <= alpha) {
+            continue;
+        }
+        // nor does a capture that loses material once the exchange plays out
+        if (!inCheck && _search._params.seeCaptures && !(move.flags & IsPromotion) && !_gameState.see(move, 0)) {
+            _stats.seeCapturesPruned++;
+            continue;
+        }
+
+        _gameState.makeMove<Color>(move);
+
+        int moveVal = -quiescence<Them>(ply + 1, -beta, -alpha);
+
+        _gameState.unmakeMove<Color>(move);
+
+        if (_search._stop) {
+            return 0;
+        }
+
+        if (moveVal > bestVal) {
+            bestVal = moveVal;
+        }
+        alpha = std::max(alpha, bestVal);
+        if (alpha >= beta) {
+            break;
+        }
+    }
+
+    // in check with no way out
+    if (inCheck && moveCount == 0) {
+        return -MATE_SCORE + ply;
+    }
+    return bestVal;
+}
+
+int ChessSearch::evaluateBoard(GameState& gameState) {
+    // material and piece square values are kept up to date by every move, the leaf only reads them off
+    int score = gameState.score();
+
+    // mobility and king safety come from both sides' attack maps, the move generator may have built one already
+    const GameState::AttackMap& white = gameState.attackMap(WHITE_PAWNS);
+    const GameState::AttackMap& black = gameState.attackMap(BLACK_PAWNS);
+    const uint64_t whiteReach = (white.knights | white.bishops | white.rooks) & ~gameState._bitboards[WHITE_ALL_PIECES].getData() & ~black.pawns;
+    const uint64_t blackReach = (black.knights | black.bishops | black.rooks) & ~gameState._bitboards[BLACK_ALL_PIECES].getData() & ~white.pawns;
+    score += MOBILITY_WEIGHT * (std::popcount(whiteReach) - std::popcount(blackReach));
+    // a king's own attacks are the squares around it
+    score += KING_ZONE_WEIGHT * (std::popcount(white.all & black.king) - std::popcount(black.all & white.king));
+    return score * gameState.color;
+}
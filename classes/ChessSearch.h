@@ -0,0 +1,217 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "GameState.h"
+#include "TranspositionTable.h"
+#include "MovePicker.h"
+
+constexpr int negInfinite = -1000000;
+constexpr int posInfinite = 1000000;
+// mate scores count down with the ply so shorter mates score higher, and still fit a TT entry
+constexpr int MATE_SCORE = 30000;
+constexpr int MATE_BOUND = MATE_SCORE - 1000;
+
+struct SearchStats {
+    uint64_t nodes = 0;
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    uint64_t ttCutoffs = 0;
+    uint64_t qnodes = 0;            // the part of nodes spent in quiescence
+    uint64_t nullMoveTries = 0;
+    uint64_t nullMoveCutoffs = 0;
+    uint64_t lmrReductions = 0;     // late moves searched shallower than the rest
+    uint64_t lmrResearches = 0;     // the ones that beat alpha anyway and had to go again at full depth
+    uint64_t reverseFutilityCutoffs = 0;
+    uint64_t razorTries = 0;
+    uint64_t razorCutoffs = 0;
+    uint64_t razorNodes = 0;        // spent in the quiescence searches razoring does to check itself
+    uint64_t futilityPruned = 0;    // quiet moves skipped without being searched
+    uint64_t lateMovePruned = 0;    // nodes where the remaining quiet moves were dropped
+    uint64_t checkExtensions = 0;
+    uint64_t recaptureExtensions = 0;
+    uint64_t singularTries = 0;
+    uint64_t singularExtensions = 0;
+    uint64_t seeQuietsPruned = 0;
+    uint64_t seeCapturesPruned = 0; // in quiescence
+
+    double ttHitRate() const { return ttProbes ? (double)ttHits / ttProbes : 0.0; }
+    void add(const SearchStats& other) {
+        nodes += other.nodes;
+        ttProbes += other.ttProbes;
+        ttHits += other.ttHits;
+        ttCutoffs += other.ttCutoffs;
+        qnodes += other.qnodes;
+        nullMoveTries += other.nullMoveTries;
+        nullMoveCutoffs += other.nullMoveCutoffs;
+        lmrReductions += other.lmrReductions;
+        lmrResearches += other.lmrResearches;
+        reverseFutilityCutoffs += other.reverseFutilityCutoffs;
+        razorTries += other.razorTries;
+        razorCutoffs += other.razorCutoffs;
+        razorNodes += other.razorNodes;
+        futilityPruned += other.futilityPruned;
+        lateMovePruned += other.lateMovePruned;
+        checkExtensions += other.checkExtensions;
+        recaptureExtensions += other.recaptureExtensions;
+        singularTries += other.singularTries;
+        singularExtensions += other.singularExtensions;
+        seeQuietsPruned += other.seeQuietsPruned;
+        seeCapturesPruned += other.seeCapturesPruned;
+    }
+};
+
+// how far a search may go, a zero time or node budget means no limit
+struct SearchLimits {
+    int maxDepth = MAX_DEPTH - 1;
+    int timeMs = 0;
+    uint64_t nodes = 0;             // checked every 1024 nodes per thread, more often for budgets too small for that
+};
+
+// search features that can be tuned or switched off, mostly so they can be measured against each other
+struct SearchParams {
+    bool pvs = true;                // null window scouts for every move after the first, re-searched if they beat alpha
+    bool aspiration = true;         // root windows around the last iteration's score
+    int aspirationWindow = 25;      // half width of the first window, it doubles every time the score falls outside
+    // null move pruning, skip our turn and search the reply shallower. still at or above beta means
+    // a real move would be too. never in check, on the PV, twice in a row or with only pawns left
+    bool nullMove = true;
+    int nullMoveMinDepth = 3;
+    int nullMoveReduction = 3;      // R, the null move search goes depth - 1 - R deep
+    int nullMoveDepthDivisor = 6;   // plus one more ply of R for every this many plies of depth
+    // late move reductions, quiet moves far down the ordering are searched shallower first.
+    // the reduction is lmrBase + ln(depth) * ln(moveNumber) / lmrDivisor plies
+    bool lmr = true;
+    int lmrMinDepth = 3;
+    int lmrMinMoves = 3;            // this many moves are searched at full depth before any reductions
+    double lmrBase = 0.75;
+    double lmrDivisor = 2.25;
+    // the static pruning near the leaves, all of it off the PV and out of check. margins are centipawns per ply of depth
+    // reverse futility, the static eval is so far above beta that a shallow search isn't going to bring it back
+    bool reverseFutility = true;
+    int reverseFutilityDepth = 6;
+    int reverseFutilityMargin = 80;
+    // razoring, the static eval is so far below alpha that only a capture could help, so quiescence decides
+    bool razoring = true;
+    int razoringDepth = 2;
+    int razoringMargin = 300;
+    // futility, a quiet move that doesn't give check can't close the gap between the static eval and alpha
+    bool futility = true;
+    int futilityDepth = 3;
+    int futilityMargin = 120;
+    // late move pruning, past lateMoveBase + depth * depth moves the rest of the quiet moves are dropped
+    bool lateMovePruning = true;
+    int lateMoveDepth = 3;
+    int lateMoveBase = 3;
+    // extensions, a forcing move is searched a ply deeper instead of the usual one less. a path gets
+    // extensionBudget of them in total, so a long run of checks can't run away with the search
+    int extensionBudget = 16;
+    bool checkExtension = true;     // moves that give check
+    bool recaptureExtension = true; // taking back on the square that was just captured on, on the PV only
+    bool singularExtension = true;  // the hash move, when no other move comes close to its stored score
+    int singularMinDepth = 6;
+    int singularMargin = 2;         // the others have to stay this far under the hash move's score, per ply of depth
+    // static exchange pruning. quiescence skips captures that lose material, and near the leaves a quiet move
+    // that gives away more than seeQuietMargin per ply of depth isn't searched
+    bool seeCaptures = true;
+    bool seeQuiets = true;
+    int seeQuietDepth = 3;
+    int seeQuietMargin = 60;
+};
+
+struct SearchResult {
+    BitMove bestMove;
+    int score = negInfinite;
+    int depth = 0;                  // last iteration that finished
+    bool found = false;
+};
+
+class ChessSearch;
+
+// one lazy SMP worker. every thread searches the same root on its own copy of the board,
+// they only talk to each other through the shared transposition table
+class SearchThread {
+public:
+    SearchThread(ChessSearch& search, int id, const GameState& gameState);
+
+    void iterativeDeepening();
+
+    const SearchStats& stats() const { return _stats; }
+    const SearchResult& result() const { return _result; }
+
+private:
+    // the root dispatches on the side to move once, everything below is templated on it
+    template <int Color> void orderRootMoves(MoveList& rootMoves);
+    template <int Color> int searchRoot(MoveList& rootMoves, int depth, int alpha, int beta, BitMove& bestMove);
+    // repeats the root search with wider windows until the score lands inside one
+    template <int Color> int aspirationSearch(MoveList& rootMoves, int depth, BitMove& bestMove);
+    template <int Color> int negamax(int depth, int ply, int alpha, int beta);
+    // captures only search at the leaves so the score doesn't hang on a half finished exchange
+    template <int Color> int quiescence(int ply, int alpha, int beta);
+    void checkLimits();
+    // a quiet move cut off: it becomes a killer and the countermove to the move before it, and gains history
+    // while the quiet moves searched ahead of it lose some
+    void updateQuietHistory(const BitMove& move, const BitMove* triedQuiets, int triedCount, int depth, int ply);
+    // the counter move table slot for the move that led to this ply
+    uint16_t* counterMoveSlot(int ply);
+    // true if the side to move has something besides pawns and the king. without it zugzwang is common
+    // enough that passing can't be trusted to be the worst option
+    template <int Color> bool hasNonPawnMaterial() const;
+
+    ChessSearch& _search;
+    int _id;
+    int _pollMask;                      // the limits are checked whenever the node count has none of these bits set
+    GameState _gameState;
+    SearchStats _stats;
+    SearchResult _result;
+    BitMove _killers[MAX_PLY][NUM_KILLERS];
+    QuietHistory _history;
+    BitMove _currentMove[MAX_PLY];      // the move being searched at each ply, for the countermove lookup. empty for a null move
+    uint8_t _reductions[MAX_DEPTH][MAX_MOVES];  // late move reductions by depth and move number, from the params
+    uint16_t _excludedMove[MAX_PLY];    // packed, the hash move a singular extension test is searching without
+    uint8_t _pathExtensions[MAX_PLY];   // extensions spent on the way down to each ply
+};
+
+// the chess AI. headless so the perft/bench tools can drive it without the GUI
+class ChessSearch {
+public:
+    // transposition table budget, 0 turns the table off
+    void setHashSize(int megabytes) { _tt.resize(megabytes); }
+    int hashSizeMB() const { return _tt.sizeMB(); }
+    // forget everything learned from earlier games
+    void clear() { _tt.clear(); }
+    // lazy SMP worker count, 1 searches on the calling thread only
+    void setThreads(int threads) { _threads = threads < 1 ? 1 : threads; }
+    int threads() const { return _threads; }
+    void setParams(const SearchParams& params) { _params = params; }
+    const SearchParams& params() const { return _params; }
+
+    // iterative deepening up to the limits, returns the result of the last iteration that finished. if not even
+    // depth 1 did, the first root move in move ordering comes back at depth 0. found is only false with no legal move
+    SearchResult search(GameState& gameState, const SearchLimits& limits);
+    // fixed depth search, the same as a search limited only by depth
+    SearchResult findBestMove(GameState& gameState, int depth);
+    // ask a running search to wrap up, safe to call from another thread
+    void stop() { _stop = true; }
+
+    int evaluateBoard(GameState& gameState);
+
+    // totals over all threads, and each thread on its own
+    const SearchStats& stats() const { return _stats; }
+    const std::vector<SearchStats>& threadStats() const { return _threadStats; }
+    int hashfull() const { return _tt.hashfull(); }
+
+private:
+    friend class SearchThread;
+
+    TranspositionTable _tt;
+    int _threads = 1;
+    SearchParams _params;
+    SearchStats _stats;
+    std::vector<SearchStats> _threadStats;
+    SearchLimits _limits;
+    std::chrono::steady_clock::time_point _startTime;
+    std::atomic<bool> _stop { false };
+};
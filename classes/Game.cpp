@@ -15,6 +15,10 @@ Game::Game()
 	_gameOptions.rowY = 0;
 	_gameOptions.score = 0;
 	_gameOptions.AIDepthSearches = 0;
+	_gameOptions.AIMAXDepth = 0;
+	_gameOptions.AITimeLimitMs = 0;
+	_gameOptions.AINodeLimit = 0;
+	_gameOptions.AIThreads = 1;
 	_gameOptions.AIvsAI = false;
 
 	_table = nullptr;
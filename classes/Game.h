@@ -39,8 +39,11 @@ struct GameOptions
 	int gameNumber;
 	unsigned int currentTurnNo;
 	int score;
-	int AIDepthSearches;
-	int AIMAXDepth;
+	int AIDepthSearches;		// depth the last AI search finished
+	int AIMAXDepth;				// deepest iteration the AI will start
+	int AITimeLimitMs;			// time budget per AI move, 0 for none
+	int AINodeLimit;			// node budget per AI move, 0 for none
+	int AIThreads;				// search threads the AI may use
 	bool AIvsAI;
 };
 
@@ -1,380 +1,531 @@
 
 #include <algorithm>
+#include <cctype>
 #include <iostream>
+#include <sstream>
 #include "GameState.h"
 #include "MagicBitboards.h"
 
-static int _bitboardLookup[128];
-static bool _initedMagic = false;
-static BitBoard _pawnAttacks[2][64]; // Precomputed pawn attacks for each square
-
-void GameState::init(const char* newState, char player) {
+void GameState::init(const char* newState, char player, int castlingRights, int enPassantSquare) {
     std::memcpy(state, newState, 64);
     color = player;
     flags = 0;
-    _zobristHash[0] = 0;
-    _zobristHash[1] = 0;
-    _attackBitBoard.setData(0);
-    // Clear all bitboards
+    castling = (unsigned char)(castlingRights & AllCastling);
+    enPassant = (signed char)enPassantSquare;
+    stackPtr = 0;
+
+    // build the bitboards once, pushMove keeps them up to date from here on
     for (int i = 0; i < e_numBitboards; ++i) {
         _bitboards[i].setData(0);
     }
 
-    if (!_initedMagic) {
-        initMagicBitboards();
-        // remove branching when we make the bitboards
-        for(int i=0; i<128; i++) { _bitboardLookup[i] = 0; }
-
-        _bitboardLookup['P'] = WHITE_PAWNS;
-        _bitboardLookup['N'] = WHITE_KNIGHTS;
-        _bitboardLookup['B'] = WHITE_BISHOPS;
-        _bitboardLookup['R'] = WHITE_ROOKS;
-        _bitboardLookup['Q'] = WHITE_QUEENS;
-        _bitboardLookup['K'] = WHITE_KING;
-        _bitboardLookup['p'] = BLACK_PAWNS;
-        _bitboardLookup['n'] = BLACK_KNIGHTS;
-        _bitboardLookup['b'] = BLACK_BISHOPS;
-        _bitboardLookup['r'] = BLACK_ROOKS;
-        _bitboardLookup['q'] = BLACK_QUEENS;
-        _bitboardLookup['k'] = BLACK_KING;
-        _bitboardLookup['0'] = EMPTY_SQUARES;
-
-        for(int square = 0; square < 64; square++) {
-            _pawnAttacks[0][square].setData(generatePawnAttacksBitBoard(square, WHITE));
-            _pawnAttacks[1][square].setData(generatePawnAttacksBitBoard(square, BLACK));
-        }
+    for(int i = 0; i<64; i++) {
+        int bitIndex = bitboardLookup[(unsigned char)state[i]];
+        _bitboards[bitIndex] |= 1ULL << i;
+    }
+
+    _bitboards[WHITE_ALL_PIECES] = _bitboards[WHITE_PAWNS].getData() | _bitboards[WHITE_KNIGHTS].getData() |
+    _bitboards[WHITE_BISHOPS].getData() | _bitboards[WHITE_ROOKS].getData() |
+    _bitboards[WHITE_QUEENS].getData() | _bitboards[WHITE_KING].getData();
+
+    _bitboards[BLACK_ALL_PIECES] = _bitboards[BLACK_PAWNS].getData() | _bitboards[BLACK_KNIGHTS].getData() |
+    _bitboards[BLACK_BISHOPS].getData() | _bitboards[BLACK_ROOKS].getData() |
+    _bitboards[BLACK_QUEENS].getData() | _bitboards[BLACK_KING].getData();
+
+    _bitboards[OCCUPANCY] = _bitboards[WHITE_ALL_PIECES].getData() | _bitboards[BLACK_ALL_PIECES].getData();
+    _bitboards[EMPTY_SQUARES] = ~_bitboards[OCCUPANCY].getData();
 
-        _initedMagic = true;
+    _zobristHash = computeHash();
+    _score = computeScore();
+}
 
-        std::cout << "initialized magic bitboards and bitboard lookup" << std::endl;
+int GameState::computeScore() const {
+    int score = 0;
+    for (int square = 0; square < 64; square++) {
+        score += pieceSquareValues[bitboardLookup[(unsigned char)state[square]]][square];
     }
+    return score;
 }
 
-void GameState::shutdown() {
-    cleanupMagicBitboards();
+uint64_t GameState::computeHash() const {
+    uint64_t hash = 0;
+    for (int square = 0; square < 64; square++) {
+        hash ^= zobristKeys.pieces[bitboardLookup[(unsigned char)state[square]]][square];
+    }
+    hash ^= zobristKeys.castling[castling];
+    if (enPassant >= 0) {
+        hash ^= zobristKeys.enPassant[enPassant & 7];
+    }
+    if (color == BLACK) {
+        hash ^= zobristKeys.side;
+    }
+    return hash;
 }
 
-void GameState::addPawnBitboardMovesToList(std::vector<BitMove>& moves, const BitBoard bitboard, const int shift) {
-    if (bitboard.getData() == 0)
-        return;
-    bitboard.forEachBit([&](int toSquare) {
-        int fromSquare = toSquare - shift; // Correct calculation for fromSquare
-        moves.emplace_back(fromSquare, toSquare, Pawn);
-    });
+bool GameState::initFromFEN(const std::string& fen) {
+    // FEN lists rank 8 first, our state string starts at a1
+    char newState[64];
+    std::memset(newState, '0', sizeof(newState));
+    int row = 7;
+    int col = 0;
+    size_t i = 0;
+    for (; i < fen.size() && fen[i] != ' '; i++) {
+        char c = fen[i];
+        if (c == '/') {
+            row--;
+            col = 0;
+        } else if (isdigit((unsigned char)c)) {
+            col += c - '0';
+        } else {
+            if (row < 0 || col > 7 || !strchr("PNBRQKpnbrqk", c)) {
+                return false;
+            }
+            newState[row * 8 + col] = c;
+            col++;
+        }
+    }
+    // the remaining fields are optional, white to move with no castling or en passant
+    std::istringstream fields(fen.substr(i));
+    std::string active, rights, target;
+    fields >> active >> rights >> target;
+
+    char player = (active == "b" || active == "B") ? BLACK : WHITE;
+
+    int castlingRights = NoCastling;
+    for (char c : rights) {
+        switch (c) {
+            case 'K': castlingRights |= WhiteKingSide; break;
+            case 'Q': castlingRights |= WhiteQueenSide; break;
+            case 'k': castlingRights |= BlackKingSide; break;
+            case 'q': castlingRights |= BlackQueenSide; break;
+        }
+    }
+
+    int enPassantSquare = -1;
+    if (target.size() == 2 && target[0] >= 'a' && target[0] <= 'h' && target[1] >= '1' && target[1] <= '8') {
+        enPassantSquare = (target[1] - '1') * 8 + (target[0] - 'a');
+    }
+
+    init(newState, player, castlingRights, enPassantSquare);
+    return true;
+}
+
+void GameState::addPawnMove(MoveList& moves, int fromSquare, int toSquare, int flags) {
+    // reaching the last rank fans out into every promotion, the queen first since it's nearly always best
+    if (toSquare >= 56 || toSquare < 8) {
+        moves.emplace_back(fromSquare, toSquare, Pawn, flags | IsPromotion);
+        moves.emplace_back(fromSquare, toSquare, Pawn, flags | IsPromotion | PromoteKnight);
+        moves.emplace_back(fromSquare, toSquare, Pawn, flags | IsPromotion | PromoteRook);
+        moves.emplace_back(fromSquare, toSquare, Pawn, flags | IsPromotion | PromoteBishop);
+    } else {
+        moves.emplace_back(fromSquare, toSquare, Pawn, flags);
+    }
 }
 
-void GameState::generatePawnMoveList(std::vector<BitMove>& moves, const BitBoard pawns, const BitBoard emptySquares, const BitBoard enemyPieces, char color) {
+template <int Color>
+bool GameState::enPassantIsLegal(int fromSquare, const MoveMasks& masks) const {
+    const int captureSquare = Color == WHITE ? enPassant - 8 : enPassant + 8;
+    // in check the capture has to take the checker or block it
+    if (masks.checkers && !(masks.checkers & (1ULL << captureSquare)) && !(masks.targets & (1ULL << enPassant))) {
+        return false;
+    }
+    // two pawns leave the rank at once, which can open a line onto the king no pin mask sees,
+    // so replay the occupancy and look for sliders
+    constexpr int them = Color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+    const uint64_t occupancy = (_bitboards[OCCUPANCY].getData() ^ (1ULL << fromSquare) ^ (1ULL << captureSquare)) | (1ULL << enPassant);
+    const uint64_t queens = _bitboards[WHITE_QUEENS + them].getData();
+    const uint64_t rooks = _bitboards[WHITE_ROOKS + them].getData() | queens;
+    const uint64_t bishops = _bitboards[WHITE_BISHOPS + them].getData() | queens;
+    return !(getRookAttacks(masks.kingSquare, occupancy) & rooks) && !(getBishopAttacks(masks.kingSquare, occupancy) & bishops);
+}
+
+template <int Color>
+void GameState::generatePawnMoveList(MoveList& moves, const BitBoard pawns, const MoveMasks& masks, MoveGenType type) {
     if (pawns.getData() == 0)
         return;
 
-    BitBoard demoRight(NotAFile);
-    BitBoard demoLeft(NotHFile);
-
-    // Calculate single pawn moves forward
-    BitBoard singleMoves = (color == WHITE) ? (pawns.getData() << 8) & emptySquares.getData() : (pawns.getData() >> 8) & emptySquares.getData();
-    // Calculate double pawn moves from starting rank
-    BitBoard doubleMoves = (color == WHITE) ? ((singleMoves.getData() & Rank3) << 8) & emptySquares.getData() : ((singleMoves.getData() & Rank6) >> 8) & emptySquares.getData();
-    // Calculate left and right pawn captures
-    BitBoard capturesLeft = (color == WHITE) ? ((pawns.getData() & NotAFile) << 7) & enemyPieces.getData() : ((pawns.getData() & NotAFile) >> 9) & enemyPieces.getData();
-    BitBoard capturesRight = (color == WHITE) ? ((pawns.getData() & NotHFile) << 9) & enemyPieces.getData() : ((pawns.getData() & NotHFile) >> 7) & enemyPieces.getData();
-
-    int shiftForward = (color == WHITE) ? 8 : -8;
-    int doubleShift = (color == WHITE) ? 16 : -16;
-    int captureLeftShift = (color == WHITE) ? 7 : -9;
-    int captureRightShift = (color == WHITE) ? 9 : -7;
-    
-    // Add single pawn moves to the list
-    addPawnBitboardMovesToList(moves, singleMoves, shiftForward);
-
-    // Add double pawn moves to the list
-    addPawnBitboardMovesToList(moves, doubleMoves, doubleShift);
-
-    // Add pawn captures to the list
-    addPawnBitboardMovesToList(moves, capturesLeft, captureLeftShift);
-    addPawnBitboardMovesToList(moves, capturesRight, captureRightShift);
+    constexpr int side = Color == WHITE ? 0 : 1;
+    constexpr int forward = Color == WHITE ? 8 : -8;
+    constexpr uint64_t startRank = Color == WHITE ? Rank2 : Rank7;
+    constexpr uint64_t lastRank = Color == WHITE ? 0xFF00000000000000ULL : 0xFFULL;
+    const uint64_t empty = _bitboards[EMPTY_SQUARES].getData();
+    const uint64_t enemies = _bitboards[Color == WHITE ? BLACK_ALL_PIECES : WHITE_ALL_PIECES].getData();
+
+    pawns.forEachBit([&](int fromSquare) {
+        const uint64_t allowed = masks.targets & pinRestriction(fromSquare, masks);
+
+        const int singleSquare = fromSquare + forward;
+        if (empty & (1ULL << singleSquare)) {
+            // a push onto the last rank is a promotion, which belongs with the captures
+            const bool promotion = (lastRank >> singleSquare) & 1;
+            if ((allowed & (1ULL << singleSquare)) && (promotion ? type != GenQuiets : type != GenCaptures)) {
+                addPawnMove(moves, fromSquare, singleSquare, 0);
+            }
+            const int doubleSquare = singleSquare + forward;
+            if (type != GenCaptures && (startRank & (1ULL << fromSquare)) && (empty & allowed & (1ULL << doubleSquare))) {
+                moves.emplace_back(fromSquare, doubleSquare, Pawn);
+            }
+        }
+        if (type == GenQuiets) {
+            return;
+        }
+
+        BitBoard captures(attackTables.pawn[side][fromSquare] & enemies & allowed);
+        captures.forEachBit([&](int toSquare) {
+            addPawnMove(moves, fromSquare, toSquare, IsCapture);
+        });
+
+        if (enPassant >= 0 && (attackTables.pawn[side][fromSquare] & (1ULL << enPassant)) &&
+            enPassantIsLegal<Color>(fromSquare, masks)) {
+            moves.emplace_back(fromSquare, enPassant, Pawn, EnPassant | IsCapture);
+        }
+    });
+}
+
+uint64_t GameState::pinRestriction(int fromSquare, const MoveMasks& masks) const {
+    return (masks.pinned & (1ULL << fromSquare)) ? attackTables.line[masks.kingSquare][fromSquare] : ~0ULL;
 }
 
 // Generate actual move objects from a bitboard
-void GameState::generateKnightMoves(std::vector<BitMove>& moves, BitBoard knightBoard, uint64_t occupancy) {
+void GameState::generateKnightMoves(MoveList& moves, BitBoard knightBoard, const MoveMasks& masks, uint64_t targets) {
+    // a pinned knight can never stay on the line
+    knightBoard &= ~masks.pinned;
     knightBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(KnightAttacks[fromSquare] & occupancy);
+        BitBoard moveBitboard = BitBoard(attackTables.knight[fromSquare] & targets);
         // Efficiently iterate through only the set bits
         moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Knight);
+           moves.emplace_back(fromSquare, toSquare, Knight, captureFlag(toSquare));
         });
     });
 }
 
+template <int Color>
+uint64_t GameState::kingDangerSquares(const MoveMasks& masks) {
+    constexpr int them = Color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+    uint64_t danger = attackMap(them).all;
+    // the cached map stops at our king, but a slider giving check covers the squares behind it too. the checker's
+    // own square stays off, the king may be able to take it. castling is only tried out of check so it needs nothing extra
+    const uint64_t sliders = _bitboards[WHITE_BISHOPS + them].getData() | _bitboards[WHITE_ROOKS + them].getData() |
+                             _bitboards[WHITE_QUEENS + them].getData();
+    BitBoard(masks.checkers & sliders).forEachBit([&](int checker) {
+        danger |= attackTables.line[masks.kingSquare][checker] & ~(1ULL << checker);
+    });
+    return danger;
+}
+
 // Generate actual move objects from a bitboard
-void GameState::generateKingMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy) {
-    piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(KingAttacks[fromSquare] & occupancy);
-        // Efficiently iterate through only the set bits
-        moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, King);
-        });
+template <int Color>
+void GameState::generateKingMoves(MoveList& moves, const MoveMasks& masks, uint64_t targets, uint64_t attacked) {
+    constexpr int us = Color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    BitBoard moveBitboard = BitBoard(attackTables.king[masks.kingSquare] & ~_bitboards[WHITE_ALL_PIECES + us].getData() & targets & ~attacked);
+    moveBitboard.forEachBit([&](int toSquare) {
+        moves.emplace_back(masks.kingSquare, toSquare, King, captureFlag(toSquare));
     });
 }
 
+template <int Color>
+void GameState::generateCastles(MoveList& moves, const MoveMasks& masks, uint64_t attacked) {
+    if (masks.checkers) {
+        return;
+    }
+    constexpr bool white = Color == WHITE;
+    const int rights = castling & (white ? (WhiteKingSide | WhiteQueenSide) : (BlackKingSide | BlackQueenSide));
+    if (!rights) {
+        return;
+    }
+    constexpr int kingSquare = white ? 4 : 60;
+    constexpr char rook = white ? 'R' : 'r';
+    if (masks.kingSquare != kingSquare) {
+        return;
+    }
+    const uint64_t occupancy = _bitboards[OCCUPANCY].getData();
+
+    // the squares between king and rook are empty, and the king never crosses an attacked square
+    if ((rights & (WhiteKingSide | BlackKingSide)) && state[kingSquare + 3] == rook &&
+        !(occupancy & (3ULL << (kingSquare + 1))) && !(attacked & (3ULL << (kingSquare + 1)))) {
+        moves.emplace_back(kingSquare, kingSquare + 2, King, KingSideCastle);
+    }
+    if ((rights & (WhiteQueenSide | BlackQueenSide)) && state[kingSquare - 4] == rook &&
+        !(occupancy & (7ULL << (kingSquare - 3))) && !(attacked & (3ULL << (kingSquare - 2)))) {
+        moves.emplace_back(kingSquare, kingSquare - 2, King, QueenSideCastle);
+    }
+}
+
 // Generate actual move objects from a bitboard
-void GameState::generateBishopMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t friendlies)
+void GameState::generateBishopMoves(MoveList& moves, BitBoard piecesBoard, const MoveMasks& masks, uint64_t targets)
 {
     piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(getBishopAttacks(fromSquare, occupancy) & ~friendlies);
+        BitBoard moveBitboard = BitBoard(getBishopAttacks(fromSquare, _bitboards[OCCUPANCY].getData()) & targets & pinRestriction(fromSquare, masks));
         // Efficiently iterate through only the set bits
         moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Bishop);
+           moves.emplace_back(fromSquare, toSquare, Bishop, captureFlag(toSquare));
         });
     });
 }
 
-void GameState::generateRooksMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t friendlies)
+void GameState::generateRooksMoves(MoveList& moves, BitBoard piecesBoard, const MoveMasks& masks, uint64_t targets)
 {
     piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(getRookAttacks(fromSquare, occupancy) & ~friendlies);
+        BitBoard moveBitboard = BitBoard(getRookAttacks(fromSquare, _bitboards[OCCUPANCY].getData()) & targets & pinRestriction(fromSquare, masks));
         // Efficiently iterate through only the set bits
         moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Rook);
+           moves.emplace_back(fromSquare, toSquare, Rook, captureFlag(toSquare));
         });
     });
 }
 
-void GameState::generateQueensMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t friendlies)
+void GameState::generateQueensMoves(MoveList& moves, BitBoard piecesBoard, const MoveMasks& masks, uint64_t targets)
 {
     piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(getQueenAttacks(fromSquare, occupancy) & ~friendlies);
+        BitBoard moveBitboard = BitBoard(getQueenAttacks(fromSquare, _bitboards[OCCUPANCY].getData()) & targets & pinRestriction(fromSquare, masks));
         // Efficiently iterate through only the set bits
         moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Queen);
+           moves.emplace_back(fromSquare, toSquare, Queen, captureFlag(toSquare));
         });
     });
 }
 
-template <ChessPiece PIECE_TYPE>
-inline BitBoard generatePieceAttackList(
-    const BitBoard pieces, 
-    const BitBoard occupancy
-) {
-    BitBoard attacks;
-
-    pieces.forEachBit([&](int fromSquare) {
-        // We'll branch on the piece type. 
-        // This uses if constexpr for compile-time resolution
-        if (PIECE_TYPE == Knight) {
-            // Combine all knight moves from `fromSquare`
-            attacks |= KnightAttacks[fromSquare];
-        }
-        else if (PIECE_TYPE == Bishop) {
-            attacks |= BitBoard(getBishopAttacks(fromSquare, occupancy.getData())); 
-        }
-        else if (PIECE_TYPE == Rook) {
-            attacks |= BitBoard(getRookAttacks(fromSquare, occupancy.getData())); 
-        }
-        else if (PIECE_TYPE == Queen) {
-            // Queen is rook + bishop combined
-            attacks |= (BitBoard(getBishopAttacks(fromSquare, occupancy.getData())) |
-                        BitBoard(getRookAttacks(fromSquare, occupancy.getData())));
-        }
-        else if (PIECE_TYPE == King) {
-            attacks |= KingAttacks[fromSquare];
-        }
-        else {
-            // Optionally handle or static_assert for unexpected piece types
-        }
-    });
+void GameState::computeAttackMap(int side, uint64_t occupancy, AttackMap& map) const {
+    const uint64_t queens = _bitboards[WHITE_QUEENS + side].getData();
+    const uint64_t pawns = _bitboards[WHITE_PAWNS + side].getData();
+    // every piece of a kind at once, the sliders go through the Kogge-Stone fills rather than a lookup each
+    const SlidingAttacks sliders = slidingAttacks(_bitboards[WHITE_ROOKS + side].getData() | queens,
+                                                  _bitboards[WHITE_BISHOPS + side].getData() | queens, occupancy);
+    map.pawns = side == WHITE_PAWNS ? WHITE_PAWN_ATTACKS(pawns) : BLACK_PAWN_ATTACKS(pawns);
+    map.knights = knightAttacks(_bitboards[WHITE_KNIGHTS + side].getData());
+    map.bishops = sliders.diagonal;
+    map.rooks = sliders.orthogonal;
+    map.king = attackTables.king[_bitboards[WHITE_KING + side].firstBit()];
+    map.all = map.pawns | map.knights | map.bishops | map.rooks | map.king;
+}
 
-    return attacks;
+uint64_t GameState::attackersTo(int square, uint64_t occupancy) const {
+    const uint64_t queens = _bitboards[WHITE_QUEENS].getData() | _bitboards[BLACK_QUEENS].getData();
+    const uint64_t rooks = _bitboards[WHITE_ROOKS].getData() | _bitboards[BLACK_ROOKS].getData() | queens;
+    const uint64_t bishops = _bitboards[WHITE_BISHOPS].getData() | _bitboards[BLACK_BISHOPS].getData() | queens;
+    const uint64_t knights = _bitboards[WHITE_KNIGHTS].getData() | _bitboards[BLACK_KNIGHTS].getData();
+    const uint64_t kings = _bitboards[WHITE_KING].getData() | _bitboards[BLACK_KING].getData();
+
+    // a white pawn attacks this square from wherever a black pawn standing here would attack
+    return (attackTables.pawn[1][square] & _bitboards[WHITE_PAWNS].getData()) |
+           (attackTables.pawn[0][square] & _bitboards[BLACK_PAWNS].getData()) |
+           (attackTables.knight[square] & knights) |
+           (attackTables.king[square] & kings) |
+           (getRookAttacks(square, occupancy) & rooks) |
+           (getBishopAttacks(square, occupancy) & bishops);
 }
 
-uint64_t GameState::generatePawnAttacksBitBoard(int square, char color) {
-    uint64_t bitboard = 0ULL;
-    int rank = square / 8;
-    int file = square % 8;
-
-    // Pawns can only attack diagonally forward
-    // For white: up-right and up-left
-    // For black: down-right and down-left
-    const int direction = (color == WHITE) ? 1 : -1;
-    
-    // Check diagonal left attack
-    if (file > 0) {  // Not on a-file
-        int r = rank + direction;
-        int f = file - 1;
-        if (r >= 0 && r < 8) {  // Stay within board bounds
-            bitboard |= 1ULL << (r * 8 + f);
-        }
-    }
-    
-    // Check diagonal right attack
-    if (file < 7) {  // Not on h-file
-        int r = rank + direction;
-        int f = file + 1;
-        if (r >= 0 && r < 8) {  // Stay within board bounds
-            bitboard |= 1ULL << (r * 8 + f);
-        }
+bool GameState::isInCheck() const {
+    const int kingIdx = (color == WHITE) ? WHITE_KING : BLACK_KING;
+    if (_bitboards[kingIdx].getData() == 0) {
+        return false;
     }
-    return bitboard;
+    const uint64_t enemies = _bitboards[color == WHITE ? BLACK_ALL_PIECES : WHITE_ALL_PIECES].getData();
+    return (attackersTo(_bitboards[kingIdx].firstBit(), _bitboards[OCCUPANCY].getData()) & enemies) != 0;
 }
 
-const BitBoard GameState::generatePawnAttacks(const BitBoard pawns, char color) {
-    BitBoard result(0);
+// exchange values by ChessPiece. the king never gets traded, taking with it ends the exchange
+static const int seeValue[7] = { 0, 100, 300, 300, 500, 900, 0 };
 
-    pawns.forEachBit([&](int fromSquare) {
-        // Using precomputed or dynamic logic
-        result |= _pawnAttacks[color == WHITE ? 0 : 1][fromSquare];
-    });
+bool GameState::see(const BitMove& move, int threshold) const {
+    // castling can't lose anything
+    if (move.flags & (KingSideCastle | QueenSideCastle)) {
+        return threshold <= 0;
+    }
+    const int to = move.to;
+    const int victim = (move.flags & EnPassant) ? Pawn : (state[to] == '0' ? NoPiece : bitboardLookup[(unsigned char)state[to]] % BLACK_PAWNS + 1);
 
+    // swap is what the side that just captured stands to lose if it's taken back, against the threshold
+    int swap = seeValue[victim] - threshold;
+    if (swap < 0) {
+        return false;
+    }
+    swap = seeValue[move.piece] - swap;
+    if (swap <= 0) {
+        return true;
+    }
+
+    uint64_t occupied = _bitboards[OCCUPANCY].getData() ^ (1ULL << move.from) ^ (1ULL << to);
+    if (move.flags & EnPassant) {
+        occupied ^= 1ULL << (color == WHITE ? to - 8 : to + 8);
+    }
+    const uint64_t queens = _bitboards[WHITE_QUEENS].getData() | _bitboards[BLACK_QUEENS].getData();
+    const uint64_t diagonals = _bitboards[WHITE_BISHOPS].getData() | _bitboards[BLACK_BISHOPS].getData() | queens;
+    const uint64_t orthogonals = _bitboards[WHITE_ROOKS].getData() | _bitboards[BLACK_ROOKS].getData() | queens;
+    uint64_t attackers = attackersTo(to, occupied);
+    int side = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    // flips every time a side takes, and ends up saying whether the mover came out ahead
+    bool result = true;
+
+    while (true) {
+        side = side == WHITE_PAWNS ? BLACK_PAWNS : WHITE_PAWNS;
+        // pieces already traded off are gone from occupied
+        attackers &= occupied;
+        const uint64_t sideAttackers = attackers & _bitboards[WHITE_ALL_PIECES + side].getData();
+        if (!sideAttackers) {
+            break;
+        }
+        result = !result;
+
+        // the cheapest piece takes. once it's off its square the slider behind it, if there is one, sees through
+        int piece = Pawn;
+        uint64_t candidates = 0;
+        for (; piece < King; piece++) {
+            candidates = sideAttackers & _bitboards[WHITE_PAWNS + side + piece - Pawn].getData();
+            if (candidates) {
+                break;
+            }
+        }
+        if (piece == King) {
+            // the king can only take if nothing is left to take it back
+            return (attackers & ~_bitboards[WHITE_ALL_PIECES + side].getData()) ? !result : result;
+        }
+        swap = seeValue[piece] - swap;
+        if (swap < (int)result) {
+            break;
+        }
+        occupied ^= candidates & (0 - candidates);
+        if (piece == Pawn || piece == Bishop || piece == Queen) {
+            attackers |= getBishopAttacks(to, occupied) & diagonals;
+        }
+        if (piece == Rook || piece == Queen) {
+            attackers |= getRookAttacks(to, occupied) & orthogonals;
+        }
+    }
     return result;
 }
 
-// Returns true if 'square' is attacked by any piece belonging to 'attackerColor'
-bool GameState::isSquareAttacked(int square, char attackerColor, const BitBoard (&boards)[e_numBitboards]) {
-	const int pawnIdx   = (attackerColor == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
-	const int knightIdx = (attackerColor == WHITE) ? WHITE_KNIGHTS : BLACK_KNIGHTS;
-	const int bishopIdx = (attackerColor == WHITE) ? WHITE_BISHOPS : BLACK_BISHOPS;
-	const int rookIdx   = (attackerColor == WHITE) ? WHITE_ROOKS : BLACK_ROOKS;
-	const int queenIdx  = (attackerColor == WHITE) ? WHITE_QUEENS : BLACK_QUEENS;
-	const int kingIdx   = (attackerColor == WHITE) ? WHITE_KING : BLACK_KING;
-
-	// Get Occupancy of all pieces for sliding checks
-	BitBoard occ = boards[OCCUPANCY];
-
-	// Check Pawn Attacks
-	char targetColor = (attackerColor == WHITE) ? BLACK : WHITE; 
-	if ((generatePawnAttacksBitBoard(square, targetColor) & boards[pawnIdx].getData()) != 0) return true;
-
-	// Check Knight Attacks
-	if ((KnightAttacks[square] & boards[knightIdx].getData()) != 0) return true;
+template <int Color>
+void GameState::computeMoveMasks(MoveMasks& masks) const {
+    constexpr int us = Color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    constexpr int them = Color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+    const uint64_t friendlies = _bitboards[WHITE_ALL_PIECES + us].getData();
+    const uint64_t enemies = _bitboards[WHITE_ALL_PIECES + them].getData();
+    const uint64_t occupancy = _bitboards[OCCUPANCY].getData();
+
+    masks.kingSquare = _bitboards[WHITE_KING + us].firstBit();
+    masks.checkers = attackersTo(masks.kingSquare, occupancy) & enemies;
+    masks.pinned = 0;
+
+    // every enemy slider lined up with our king, with exactly one of our pieces in between, pins it
+    const uint64_t queens = _bitboards[WHITE_QUEENS + them].getData();
+    const uint64_t snipers = (getRookAttacks(masks.kingSquare, 0) & (_bitboards[WHITE_ROOKS + them].getData() | queens)) |
+                             (getBishopAttacks(masks.kingSquare, 0) & (_bitboards[WHITE_BISHOPS + them].getData() | queens));
+    BitBoard(snipers).forEachBit([&](int sniper) {
+        const uint64_t blockers = attackTables.between[masks.kingSquare][sniper] & occupancy;
+        if (blockers && !(blockers & (blockers - 1)) && (blockers & friendlies)) {
+            masks.pinned |= blockers;
+        }
+    });
 
-	// Check King Attacks (Neighboring kings)
-	if ((KingAttacks[square] & boards[kingIdx].getData()) != 0) return true;
+    masks.targets = ~friendlies;
+    if (masks.checkers) {
+        // one checker can be captured or blocked, two leave nothing but king moves
+        if (masks.checkers & (masks.checkers - 1)) {
+            masks.targets = 0;
+        } else {
+            const int checker = BitBoard(masks.checkers).firstBit();
+            masks.targets &= masks.checkers | attackTables.between[masks.kingSquare][checker];
+        }
+    }
+}
 
-	// Check Bishop/Queen (Diagonal) Attacks
-	uint64_t diagonalAttacks = getBishopAttacks(square, occ.getData());
-	if ((diagonalAttacks & (boards[bishopIdx].getData() | boards[queenIdx].getData())) != 0) return true;
+void GameState::generateAllMoves(MoveList& moves)
+{
+    moves.clear();
 
-	// Check Rook/Queen (Straight) Attacks
-	uint64_t straightAttacks = getRookAttacks(square, occ.getData());
-	if ((straightAttacks & (boards[rookIdx].getData() | boards[queenIdx].getData())) != 0) return true;
+    const int bitIndex = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    if (_bitboards[WHITE_KING + bitIndex].getData() == 0) {
+        return;
+    }
 
-	return false;
+    MoveMasks masks;
+    computeMoveMasks(masks);
+    generateMoves(moves, masks, GenAll);
 }
 
-void GameState::filterOutIllegalMoves(std::vector<BitMove>& moves) {
-	if (moves.empty()) return;
-
-	const char myColor = color;
-	const char opponentColor = (color == WHITE) ? BLACK : WHITE;
-	const int myKingIdx = (myColor == WHITE) ? WHITE_KING : BLACK_KING;
-
-	// Remove moves that leave the king in check
-	moves.erase(std::remove_if(moves.begin(), moves.end(), [&](const BitMove& move) {
-		
-		// Create a temporary copy of the board state
-		BitBoard tempBoards[e_numBitboards];
-		for (int i = 0; i < e_numBitboards; ++i) tempBoards[i] = _bitboards[i];
-
-		// Apply the move to the temporary boards
-		// Note: We just need occupancy correct for check detection.
-		
-		const uint64_t fromMask = 1ULL << move.from;
-		const uint64_t toMask   = 1ULL << move.to;
-		
-		// Helper to determine which bitboard a piece belongs to
-		auto getPieceIdx = [&](ChessPiece p, char c) {
-			if (p == Pawn) return c == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
-			if (p == Knight) return c == WHITE ? WHITE_KNIGHTS : BLACK_KNIGHTS;
-			if (p == Bishop) return c == WHITE ? WHITE_BISHOPS : BLACK_BISHOPS;
-			if (p == Rook) return c == WHITE ? WHITE_ROOKS : BLACK_ROOKS;
-			if (p == Queen) return c == WHITE ? WHITE_QUEENS : BLACK_QUEENS;
-			return c == WHITE ? WHITE_KING : BLACK_KING; // King
-		};
-
-		int moverIdx = getPieceIdx(static_cast<ChessPiece>(move.piece), myColor);
-		
-		// Remove from 'from'
-		tempBoards[moverIdx] &= ~fromMask;
-		tempBoards[OCCUPANCY] &= ~fromMask;
-
-		// Handle Captures (Remove opponent piece at 'to')
-		// We scan opponent boards to find what was captured (slower than lookup, but safe for generic bitboards)
-		int startOpp = (opponentColor == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
-		int endOpp   = (opponentColor == WHITE) ? WHITE_KING : BLACK_KING;
-		
-		// Specialized handling for En Passant
-		if (move.flags & EnPassant) {
-			int capSq = (myColor == WHITE) ? (move.to - 8) : (move.to + 8);
-			uint64_t capMask = 1ULL << capSq;
-			tempBoards[startOpp] &= ~capMask; // Opponent Pawns
-			tempBoards[OCCUPANCY] &= ~capMask;
-		} else {
-			// Standard capture
-			for (int i = startOpp; i <= endOpp; ++i) {
-				tempBoards[i] &= ~toMask;
-			}
-			tempBoards[OCCUPANCY] &= ~toMask; // Clear strictly to ensure no overlap before adding
-		}
-
-		// Handle Promotion
-		if ((move.flags & IsPromotion)) {
-			moverIdx = getPieceIdx(Queen, myColor); // Assume Queen promotion for check safety (mostly covers it)
-		}
-
-		// Add to 'to'
-		tempBoards[moverIdx] |= toMask;
-		tempBoards[OCCUPANCY] |= toMask;
-
-		// Handle King Move (Update King Index tracking)
-		int currentKingSquare = -1;
-		if (move.piece == King) {
-			currentKingSquare = move.to;
-		} else {
-			// If king didn't move, find him
-			currentKingSquare = tempBoards[myKingIdx].firstBit();
-		}
-
-		// If the King is attacked by the opponent after this move, the move is illegal.
-		return isSquareAttacked(currentKingSquare, opponentColor, tempBoards);
-
-	}), moves.end());
+template <int Color>
+void GameState::generateMoves(MoveList& moves, const MoveMasks& masks, MoveGenType type)
+{
+    moves.clear();
+
+    constexpr int bitIndex = Color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    constexpr int oppBitIndex = Color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+    const uint64_t stageMask = type == GenCaptures ? _bitboards[WHITE_ALL_PIECES + oppBitIndex].getData()
+                             : type == GenQuiets ? _bitboards[EMPTY_SQUARES].getData() : ~0ULL;
+
+    // the enemy attack map is only worth building when the king has somewhere to go
+    const bool castles = type != GenCaptures && !masks.checkers &&
+                         (castling & (Color == WHITE ? (WhiteKingSide | WhiteQueenSide) : (BlackKingSide | BlackQueenSide)));
+    const uint64_t kingTargets = attackTables.king[masks.kingSquare] & ~_bitboards[WHITE_ALL_PIECES + bitIndex].getData() & stageMask;
+    const uint64_t attacked = (kingTargets || castles) ? kingDangerSquares<Color>(masks) : 0;
+
+    generateKingMoves<Color>(moves, masks, stageMask, attacked);
+    // in double check only the king can move
+    if (masks.targets == 0) {
+        return;
+    }
+    if (castles) {
+        generateCastles<Color>(moves, masks, attacked);
+    }
+    const uint64_t targets = masks.targets & stageMask;
+    generateKnightMoves(moves, _bitboards[WHITE_KNIGHTS + bitIndex], masks, targets);
+    generatePawnMoveList<Color>(moves, _bitboards[WHITE_PAWNS + bitIndex], masks, type);
+    generateBishopMoves(moves, _bitboards[WHITE_BISHOPS + bitIndex], masks, targets);
+    generateRooksMoves(moves, _bitboards[WHITE_ROOKS + bitIndex], masks, targets);
+    generateQueensMoves(moves, _bitboards[WHITE_QUEENS + bitIndex], masks, targets);
 }
 
-std::vector<BitMove> GameState::generateAllMoves()
+template <int Color>
+bool GameState::moveFromPacked(uint16_t packed, const MoveMasks& masks, BitMove& move)
 {
-    std::vector<BitMove> moves;
-    moves.reserve(32);
-
-    for (int i=0; i<e_numBitboards; i++) {
-        _bitboards[i] = 0;
+    if (packed == 0) {
+        return false;
     }
-
-    for(int i = 0; i<64; i++) {
-        int bitIndex = _bitboardLookup[(unsigned char)state[i]];
-        _bitboards[bitIndex] |= 1ULL << i;
+    // same layout as packMove, from | to << 6 | promotion bits << 7
+    const int fromSquare = packed & 63;
+    const int toSquare = (packed >> 6) & 63;
+    const int promotion = (packed >> 7) & PromotionPieceMask;
+
+    constexpr int us = Color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    const int board = bitboardLookup[(unsigned char)state[fromSquare]] - us;
+    if (board < WHITE_PAWNS || board > WHITE_KING) {
+        return false;
+    }
+    if (board != WHITE_KING && masks.targets == 0) {
+        return false;
     }
 
-    _bitboards[WHITE_ALL_PIECES] = _bitboards[WHITE_PAWNS].getData() | _bitboards[WHITE_KNIGHTS].getData() |
-    _bitboards[WHITE_BISHOPS].getData() | _bitboards[WHITE_ROOKS].getData() |
-    _bitboards[WHITE_QUEENS].getData() | _bitboards[WHITE_KING].getData();
-
-    _bitboards[BLACK_ALL_PIECES] = _bitboards[BLACK_PAWNS].getData() | _bitboards[BLACK_KNIGHTS].getData() |
-    _bitboards[BLACK_BISHOPS].getData() | _bitboards[BLACK_ROOKS].getData() |
-    _bitboards[BLACK_QUEENS].getData() | _bitboards[BLACK_KING].getData();
-    
-    _bitboards[OCCUPANCY] = _bitboards[WHITE_ALL_PIECES].getData() | _bitboards[BLACK_ALL_PIECES].getData();
-
-    int bitIndex = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
-    int oppBitIndex = color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
-
-    generateKnightMoves(moves, _bitboards[WHITE_KNIGHTS + bitIndex], ~_bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generatePawnMoveList(moves, _bitboards[WHITE_PAWNS  + bitIndex], ~_bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + oppBitIndex].getData(), color);
-    generateKingMoves(moves, _bitboards[WHITE_KING + bitIndex], ~_bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generateBishopMoves(moves, _bitboards[WHITE_BISHOPS + bitIndex], _bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generateRooksMoves(moves, _bitboards[WHITE_ROOKS + bitIndex], _bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generateQueensMoves(moves, _bitboards[WHITE_QUEENS + bitIndex], _bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-
-    filterOutIllegalMoves(moves);
-
-    return moves;
+    // only the one piece gets generated, a handful of moves at most
+    MoveList moves;
+    const BitBoard piece(1ULL << fromSquare);
+    switch (board) {
+        case WHITE_PAWNS:   generatePawnMoveList<Color>(moves, piece, masks, GenAll); break;
+        case WHITE_KNIGHTS: generateKnightMoves(moves, piece, masks, masks.targets); break;
+        case WHITE_BISHOPS: generateBishopMoves(moves, piece, masks, masks.targets); break;
+        case WHITE_ROOKS:   generateRooksMoves(moves, piece, masks, masks.targets); break;
+        case WHITE_QUEENS:  generateQueensMoves(moves, piece, masks, masks.targets); break;
+        case WHITE_KING:
+        {
+            const uint64_t attacked = kingDangerSquares<Color>(masks);
+            generateKingMoves<Color>(moves, masks, 1ULL << toSquare, attacked);
+            generateCastles<Color>(moves, masks, attacked);
+        }
+            break;
+    }
+    for (const auto& candidate : moves) {
+        if (candidate.to == toSquare && (candidate.flags & PromotionPieceMask) == promotion) {
+            move = candidate;
+            return true;
+        }
+    }
+    return false;
 }
 
+// the search and MovePicker call the color templates directly
+template void GameState::computeMoveMasks<WHITE>(MoveMasks& masks) const;
+template void GameState::computeMoveMasks<BLACK>(MoveMasks& masks) const;
+template void GameState::generateMoves<WHITE>(MoveList& moves, const MoveMasks& masks, MoveGenType type);
+template void GameState::generateMoves<BLACK>(MoveList& moves, const MoveMasks& masks, MoveGenType type);
+template bool GameState::moveFromPacked<WHITE>(uint16_t packed, const MoveMasks& masks, BitMove& move);
+template bool GameState::moveFromPacked<BLACK>(uint16_t packed, const MoveMasks& masks, BitMove& move);
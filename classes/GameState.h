@@ -5,17 +5,25 @@
 #include <cstring>
 #include <cstdint>
 #include <vector>
+#include <string>
+#include <array>
 #include "Bitboard.h"
+#include "ValueTable.h"
 
 constexpr int WHITE = +1;
 constexpr int BLACK = -1;
 // Define a constant for the maximum depth of your AI.
 constexpr int MAX_DEPTH = 24;
+// quiescence search runs past the nominal depth, it gets its own bounded stretch of the make/unmake stacks
+constexpr int MAX_QUIESCENCE_PLY = 32;
+constexpr int MAX_PLY = MAX_DEPTH + MAX_QUIESCENCE_PLY;
 // Define constants for ranks and files
 constexpr uint64_t NotAFile(0xFEFEFEFEFEFEFEFEULL); // A file mask
 constexpr uint64_t NotHFile(0x7F7F7F7F7F7F7F7FULL); // H file mask
+constexpr uint64_t Rank2(0x000000000000FF00ULL); // Rank 2 mask
 constexpr uint64_t Rank3(0x0000000000FF0000ULL); // Rank 3 mask
 constexpr uint64_t Rank6(0x0000FF0000000000ULL); // Rank 6 mask
+constexpr uint64_t Rank7(0x00FF000000000000ULL); // Rank 7 mask
 
 enum AllBitBoards
 {
@@ -38,12 +46,118 @@ enum AllBitBoards
     e_numBitboards
 };
 
+// maps a state character to the bitboard it lives in
+inline constexpr std::array<int, 128> bitboardLookup = []() {
+    std::array<int, 128> lookup {};
+    lookup['P'] = WHITE_PAWNS;
+    lookup['N'] = WHITE_KNIGHTS;
+    lookup['B'] = WHITE_BISHOPS;
+    lookup['R'] = WHITE_ROOKS;
+    lookup['Q'] = WHITE_QUEENS;
+    lookup['K'] = WHITE_KING;
+    lookup['p'] = BLACK_PAWNS;
+    lookup['n'] = BLACK_KNIGHTS;
+    lookup['b'] = BLACK_BISHOPS;
+    lookup['r'] = BLACK_ROOKS;
+    lookup['q'] = BLACK_QUEENS;
+    lookup['k'] = BLACK_KING;
+    lookup['0'] = EMPTY_SQUARES;
+    return lookup;
+} ();
+
+// GameStateData::flags, things worked out about a position and cached until the next move clears them
+enum StateFlags {
+    WhiteAttacksCached = 0x01,
+    BlackAttacksCached = 0x02
+};
+
+enum CastlingRights {
+    NoCastling = 0,
+    WhiteKingSide = 0x01,
+    WhiteQueenSide = 0x02,
+    BlackKingSide = 0x04,
+    BlackQueenSide = 0x08,
+    AllCastling = 0x0F
+};
+
+// rights that survive a move touching each square, moving the king or a rook (or capturing a rook) drops them
+inline constexpr std::array<unsigned char, 64> castlingMask = []() {
+    std::array<unsigned char, 64> mask {};
+    for (int i = 0; i < 64; i++) mask[i] = AllCastling;
+    mask[0] &= ~WhiteQueenSide;
+    mask[7] &= ~WhiteKingSide;
+    mask[4] &= ~(WhiteKingSide | WhiteQueenSide);
+    mask[56] &= ~BlackQueenSide;
+    mask[63] &= ~BlackKingSide;
+    mask[60] &= ~(BlackKingSide | BlackQueenSide);
+    return mask;
+} ();
+
+// material plus piece square value of every piece on every square, from white's side. indexed by bitboard
+// like the zobrist keys so the empty board scores nothing
+inline constexpr std::array<std::array<int, 64>, e_numBitboards> pieceSquareValues = []() {
+    std::array<std::array<int, 64>, e_numBitboards> values {};
+    const int material[6] = { 100, 300, 300, 500, 900, 2000 };
+    const int* whiteTables[6] = { pawnTableW, knightTableW, bishopTableW, rookTableW, queenTableW, kingTableW };
+    const int* blackTables[6] = { pawnTableB, knightTableB, bishopTableB, rookTableB, queenTableB, kingTableB };
+    for (int piece = 0; piece < 6; piece++) {
+        for (int square = 0; square < 64; square++) {
+            values[WHITE_PAWNS + piece][square] = whiteTables[piece][square] + material[piece];
+            values[BLACK_PAWNS + piece][square] = blackTables[piece][square] - material[piece];
+        }
+    }
+    return values;
+} ();
+
+// zobrist keys, generated at compile time from a fixed seed so a position hashes the same on every run.
+// piece keys are indexed by bitboard, the non piece boards are left at zero so empty squares hash to nothing
+struct ZobristKeys {
+    uint64_t pieces[e_numBitboards][64];
+    uint64_t castling[16];
+    uint64_t enPassant[8];
+    uint64_t side;                  // xored in when black is to move
+};
+
+inline constexpr ZobristKeys zobristKeys = []() {
+    ZobristKeys keys {};
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    auto next = [&seed]() {
+        // splitmix64
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    };
+    for (int piece = WHITE_PAWNS; piece <= BLACK_KING; piece++) {
+        if (piece == WHITE_ALL_PIECES) continue;
+        for (int square = 0; square < 64; square++) {
+            keys.pieces[piece][square] = next();
+        }
+    }
+    for (int i = 0; i < 16; i++) keys.castling[i] = next();
+    for (int i = 0; i < 8; i++) keys.enPassant[i] = next();
+    keys.side = next();
+    return keys;
+} ();
+
 enum MoveFlags {
-    EnPassant = 0x01, // 0000 0001
+    EnPassant = 0x01, // 0000 0001, always set along with IsCapture
     IsCapture = 0x02, // 0000 0010
     KingSideCastle = 0x04, // 0000 0100
     QueenSideCastle = 0x08, // 0000 1000
-    IsPromotion = 0x10 // 0001 0000
+    IsPromotion = 0x10, // 0001 0000
+    // the two bits above IsPromotion pick the new piece, zero is a queen
+    PromoteKnight = 0x20, // 0010 0000
+    PromoteBishop = 0x40, // 0100 0000
+    PromoteRook = 0x60, // 0110 0000
+    PromotionPieceMask = 0x60
+};
+
+// which moves a generator call produces. captures take every promotion too so the quiet stage never sees one
+enum MoveGenType {
+    GenCaptures,
+    GenQuiets,
+    GenAll
 };
 
 #pragma pack(push, 1)
@@ -58,6 +172,12 @@ struct BitMove {
         
     BitMove() : from(0), to(0), piece(NoPiece), flags(0) { }
     
+    // the piece a promotion turns into
+    ChessPiece promotion() const {
+        constexpr ChessPiece pieces[4] = { Queen, Knight, Bishop, Rook };
+        return pieces[(flags & PromotionPieceMask) >> 5];
+    }
+
     bool operator==(const BitMove& other) const {
         return from == other.from && 
                to == other.to && 
@@ -67,82 +187,401 @@ struct BitMove {
 };
 #pragma pack(pop)
 
+// no chess position has more than 218 legal moves
+constexpr int MAX_MOVES = 256;
+
+// fixed capacity move list that lives on the stack so generating moves never touches the heap
+struct MoveList {
+    // the union keeps the moves uninitialized, only the first count entries are ever valid
+    union {
+        BitMove moves[MAX_MOVES];
+    };
+    int count;
+
+    MoveList() : count(0) { }
+
+    inline void emplace_back(int from, int to, ChessPiece piece, int flags = 0) {
+        assert(count < MAX_MOVES);
+        moves[count++] = BitMove(from, to, piece, flags);
+    }
+    inline void push_back(const BitMove& move) {
+        assert(count < MAX_MOVES);
+        moves[count++] = move;
+    }
+    inline void clear() { count = 0; }
+    inline int size() const { return count; }
+    inline bool empty() const { return count == 0; }
+
+    BitMove& operator[](int index) { return moves[index]; }
+    const BitMove& operator[](int index) const { return moves[index]; }
+    BitMove* begin() { return moves; }
+    BitMove* end() { return moves + count; }
+    const BitMove* begin() const { return moves; }
+    const BitMove* end() const { return moves + count; }
+};
+
 struct alignas(32) GameStateData {
     char state[64];                 // persisitent
+    BitBoard _bitboards[e_numBitboards]; // kept in step with state by applyMove
+    uint64_t _zobristHash;          // full position key, kept up to date by applyMove
+    int _score;                     // sum of pieceSquareValues, kept up to date by applyMove
     int flags;
     char color;                     // BLACK or WHITE
+    unsigned char castling;         // CastlingRights still available
+    signed char enPassant;          // square a pawn can capture onto en passant, -1 for none
 
-    GameStateData() : flags(0)
-        , color(WHITE) {
+    GameStateData() : _zobristHash(0)
+        , _score(0)
+        , flags(0)
+        , color(WHITE)
+        , castling(NoCastling)
+        , enPassant(-1) {
         std::memset(state, '0', sizeof(state));
     }
     GameStateData(const GameStateData&) = default;
     GameStateData& operator=(const GameStateData&) = default;
 };
 
+// everything unmakeMove needs that it can't get back from the move itself
+struct UndoRecord {
+    uint64_t zobristHash;
+    int score;
+    char movedPiece;
+    char capturedPiece;
+    unsigned char castling;
+    signed char enPassant;
+    int flags;
+};
+
 class GameState : public GameStateData {
 public:
-    GameStateData stateStack[MAX_DEPTH];
+    GameStateData stateStack[MAX_PLY];
+    UndoRecord undoStack[MAX_PLY];
     int stackPtr = 0;
 
-    uint64_t _zobristHash[2]; // when one hash value is made, the other is made as well because it's just a xor of the first by the color bit
-    BitBoard _bitboards[e_numBitboards];
-    BitBoard _attackBitBoard;
-
     GameState() : stackPtr(0) { }
 
-    void init(const char* newState, char player);
+    void init(const char* newState, char player, int castlingRights = NoCastling, int enPassantSquare = -1);
+    // set up from a FEN string, the move clocks are ignored
+    bool initFromFEN(const std::string& fen);
+
+    inline uint64_t hash() const { return _zobristHash; }
+    // full recompute of the zobrist key, init uses it and it's handy for checking the incremental one
+    uint64_t computeHash() const;
+    // material and piece square total from white's side, the static eval is just this
+    inline int score() const { return _score; }
+    int computeScore() const;
 
+    // copy-make, saves the whole GameStateData so popState can put it back
     inline void pushMove(const BitMove& move) {
         pushState();
+        color == WHITE ? applyMove<WHITE>(move) : applyMove<BLACK>(move);
+    }
+
+    inline void pushState() {
+        assert(stackPtr < MAX_PLY);
+        stateStack[stackPtr++] = static_cast<const GameStateData&>(*this);
+    }
+    inline void popState() {
+        assert(stackPtr > 0);
+        static_cast<GameStateData&>(*this) = stateStack[--stackPtr];
+    }
+
+    // make/unmake, the search path. builds with CHESS_COPY_MAKE fall back to pushMove/popState
+    // so both can be benchmarked on the same search. Color is the side playing the move, the search
+    // knows it at compile time so the shifts and board indices below are all constants
+    template <int Color>
+    inline void makeMove(const BitMove& move) {
+#if defined(CHESS_COPY_MAKE)
+        pushState();
+        applyMove<Color>(move);
+#else
+        assert(stackPtr < MAX_PLY);
+        UndoRecord& undo = undoStack[stackPtr++];
+        undo.movedPiece = state[move.from];
+        undo.capturedPiece = state[move.to];
+        undo.castling = castling;
+        undo.enPassant = enPassant;
+        undo.zobristHash = _zobristHash;
+        undo.score = _score;
+        undo.flags = flags;
+        applyMove<Color>(move);
+#endif
+    }
+
+    template <int Color>
+    inline void unmakeMove(const BitMove& move) {
+#if defined(CHESS_COPY_MAKE)
+        popState();
+#else
+        assert(stackPtr > 0);
+        const UndoRecord& undo = undoStack[--stackPtr];
+        color = Color;
+        flags = undo.flags;
+        castling = undo.castling;
+        enPassant = undo.enPassant;
+        _zobristHash = undo.zobristHash;
+        _score = undo.score;
+
+        constexpr int us = Color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+        constexpr int them = Color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+        const uint64_t fromMask = 1ULL << move.from;
+        const uint64_t toMask = 1ULL << move.to;
+
+        if (move.flags & KingSideCastle) {
+            const uint64_t rookMask = (1ULL << (move.to + 1)) | (1ULL << (move.to - 1));
+            _bitboards[WHITE_ROOKS + us] ^= rookMask;
+            _bitboards[WHITE_ALL_PIECES + us] ^= rookMask;
+            state[move.to + 1] = state[move.to - 1];
+            state[move.to - 1] = '0';
+        } else if (move.flags & QueenSideCastle) {
+            const uint64_t rookMask = (1ULL << (move.to - 2)) | (1ULL << (move.to + 1));
+            _bitboards[WHITE_ROOKS + us] ^= rookMask;
+            _bitboards[WHITE_ALL_PIECES + us] ^= rookMask;
+            state[move.to - 2] = state[move.to + 1];
+            state[move.to + 1] = '0';
+        } else if (move.flags & EnPassant) {
+            const int captureSquare = Color == WHITE ? move.to - 8 : move.to + 8;
+            const uint64_t captureMask = 1ULL << captureSquare;
+            _bitboards[WHITE_PAWNS + them] ^= captureMask;
+            _bitboards[WHITE_ALL_PIECES + them] ^= captureMask;
+            state[captureSquare] = Color == WHITE ? 'p' : 'P';
+        } else if (move.flags & IsPromotion) {
+            // turn the new piece back into a pawn so the from/to flip below lands on the pawn board
+            _bitboards[WHITE_PAWNS + us + move.promotion() - Pawn] ^= toMask;
+            _bitboards[WHITE_PAWNS + us] ^= toMask;
+        }
+
+        _bitboards[bitboardLookup[(unsigned char)undo.movedPiece]] ^= fromMask | toMask;
+        _bitboards[WHITE_ALL_PIECES + us] ^= fromMask | toMask;
+        if (undo.capturedPiece != '0') {
+            _bitboards[bitboardLookup[(unsigned char)undo.capturedPiece]] ^= toMask;
+            _bitboards[WHITE_ALL_PIECES + them] ^= toMask;
+        }
+        state[move.from] = undo.movedPiece;
+        state[move.to] = undo.capturedPiece;
+
+        _bitboards[OCCUPANCY] = _bitboards[WHITE_ALL_PIECES].getData() | _bitboards[BLACK_ALL_PIECES].getData();
+        _bitboards[EMPTY_SQUARES] = ~_bitboards[OCCUPANCY].getData();
+#endif
+    }
+
+    // the same for callers that don't know the side at compile time, one branch on color and then the templates
+    inline void makeMove(const BitMove& move) {
+        color == WHITE ? makeMove<WHITE>(move) : makeMove<BLACK>(move);
+    }
+    // color has already passed to the side replying, the move belongs to the other one
+    inline void unmakeMove(const BitMove& move) {
+        color == WHITE ? unmakeMove<BLACK>(move) : unmakeMove<WHITE>(move);
+    }
+
+    // passes the turn without touching the board, for null move pruning. Color is the side passing,
+    // and it can't be in check. only the en passant square, the side key and the cache flags change
+    template <int Color>
+    inline void makeNullMove() {
+#if defined(CHESS_COPY_MAKE)
+        pushState();
+#else
+        assert(stackPtr < MAX_PLY);
+        UndoRecord& undo = undoStack[stackPtr++];
+        undo.enPassant = enPassant;
+        undo.zobristHash = _zobristHash;
+        undo.flags = flags;
+#endif
+        if (enPassant >= 0) {
+            _zobristHash ^= zobristKeys.enPassant[enPassant & 7];
+        }
+        enPassant = -1;
+        color = Color == WHITE ? BLACK : WHITE;
+        _zobristHash ^= zobristKeys.side;
+        // the maps would still be right, but they live in the slot for the old stackPtr
+        flags = 0;
+    }
+
+    template <int Color>
+    inline void unmakeNullMove() {
+#if defined(CHESS_COPY_MAKE)
+        popState();
+#else
+        assert(stackPtr > 0);
+        const UndoRecord& undo = undoStack[--stackPtr];
+        color = Color;
+        flags = undo.flags;
+        enPassant = undo.enPassant;
+        _zobristHash = undo.zobristHash;
+#endif
+    }
+
+    // plays a move for good, no undo record. the GUI uses this to keep its state in step with the board
+    inline void playMove(const BitMove& move) {
+        color == WHITE ? applyMove<WHITE>(move) : applyMove<BLACK>(move);
+    }
+
+    // everything the generator works out once per node before it emits a single move
+    struct MoveMasks {
+        int kingSquare;
+        uint64_t checkers;          // enemy pieces giving check
+        uint64_t pinned;            // our pieces that can only slide along the line to our king
+        uint64_t targets;           // squares a non king move may land on, blocking or capturing when in check
+    };
+
+    // legal moves only, pins and checks are worked out once up front instead of testing every move
+    void generateAllMoves(MoveList& moves);
+    // the staged version, the masks are computed once and shared by every stage of a node.
+    // Color has to be the side to move, the search dispatches on it once at the root
+    template <int Color> void computeMoveMasks(MoveMasks& masks) const;
+    template <int Color> void generateMoves(MoveList& moves, const MoveMasks& masks, MoveGenType type);
+    // turns a packed TT or killer move back into a full move if it's legal here, without generating the whole list
+    template <int Color> bool moveFromPacked(uint16_t packed, const MoveMasks& masks, BitMove& move);
+    // the same for whoever is to move
+    void computeMoveMasks(MoveMasks& masks) const {
+        color == WHITE ? computeMoveMasks<WHITE>(masks) : computeMoveMasks<BLACK>(masks);
+    }
+    void generateMoves(MoveList& moves, const MoveMasks& masks, MoveGenType type) {
+        color == WHITE ? generateMoves<WHITE>(moves, masks, type) : generateMoves<BLACK>(moves, masks, type);
+    }
+    bool moveFromPacked(uint16_t packed, const MoveMasks& masks, BitMove& move) {
+        return color == WHITE ? moveFromPacked<WHITE>(packed, masks, move) : moveFromPacked<BLACK>(packed, masks, move);
+    }
+    // true when the side to move has its king attacked
+    bool isInCheck() const;
+    // static exchange evaluation. true if the move, made by the side to move, comes out at least threshold
+    // ahead once both sides have traded off everything that bears on its square, cheapest piece first.
+    // sliders lined up behind the first attackers join in as the pieces in front of them leave. pins are ignored
+    bool see(const BitMove& move, int threshold) const;
+
+    // everything one side attacks, piece type by piece type. queens show up in both bishops and rooks
+    struct AttackMap {
+        uint64_t pawns;
+        uint64_t knights;
+        uint64_t bishops;
+        uint64_t rooks;
+        uint64_t king;
+        uint64_t all;
+    };
+    // side is WHITE_PAWNS or BLACK_PAWNS, the sliders stop at the first piece in occupancy
+    void computeAttackMap(int side, uint64_t occupancy, AttackMap& map) const;
+    // the same for the board as it stands, worked out the first time a node asks and shared by
+    // the king move legality, castling and the eval from then on
+    inline const AttackMap& attackMap(int side) {
+        const int cached = side == WHITE_PAWNS ? WhiteAttacksCached : BlackAttacksCached;
+        AttackMap& map = _attackMaps[stackPtr][side == WHITE_PAWNS ? 0 : 1];
+        if (!(flags & cached)) {
+            computeAttackMap(side, _bitboards[OCCUPANCY].getData(), map);
+            flags |= cached;
+        }
+        return map;
+    }
+private:
+    // plays the move on the board, the caller is responsible for saving what it needs to undo it
+    template <int Color>
+    inline void applyMove(const BitMove& move) {
+        constexpr int us = Color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+        constexpr int them = Color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+        const uint64_t fromMask = 1ULL << move.from;
+        const uint64_t toMask = 1ULL << move.to;
+
         unsigned char fromPiece = state[move.from];
+        unsigned char toPiece = state[move.to];
+        const int moverIdx = bitboardLookup[fromPiece];
+        const int capturedIdx = bitboardLookup[toPiece];
+        uint64_t hash = _zobristHash;
+        int score = _score;
+
+        // a capture clears the victim out of its own board before the mover lands
+        if (toPiece != '0') {
+            _bitboards[capturedIdx] ^= toMask;
+            _bitboards[WHITE_ALL_PIECES + them] ^= toMask;
+        }
+        _bitboards[moverIdx] ^= fromMask | toMask;
+        _bitboards[WHITE_ALL_PIECES + us] ^= fromMask | toMask;
+        hash ^= zobristKeys.pieces[capturedIdx][move.to];
+        hash ^= zobristKeys.pieces[moverIdx][move.from] ^ zobristKeys.pieces[moverIdx][move.to];
+        score += pieceSquareValues[moverIdx][move.to] - pieceSquareValues[moverIdx][move.from] - pieceSquareValues[capturedIdx][move.to];
         state[move.from] = '0';
         state[move.to] = fromPiece;
+
         if (move.flags & KingSideCastle) {
+            const uint64_t rookMask = (1ULL << (move.to + 1)) | (1ULL << (move.to - 1));
+            _bitboards[WHITE_ROOKS + us] ^= rookMask;
+            _bitboards[WHITE_ALL_PIECES + us] ^= rookMask;
+            hash ^= zobristKeys.pieces[WHITE_ROOKS + us][move.to + 1] ^ zobristKeys.pieces[WHITE_ROOKS + us][move.to - 1];
+            score += pieceSquareValues[WHITE_ROOKS + us][move.to - 1] - pieceSquareValues[WHITE_ROOKS + us][move.to + 1];
             state[move.to - 1] = state[move.to + 1];
             state[move.to + 1] = '0';
         } else if (move.flags & QueenSideCastle) {
+            const uint64_t rookMask = (1ULL << (move.to - 2)) | (1ULL << (move.to + 1));
+            _bitboards[WHITE_ROOKS + us] ^= rookMask;
+            _bitboards[WHITE_ALL_PIECES + us] ^= rookMask;
+            hash ^= zobristKeys.pieces[WHITE_ROOKS + us][move.to - 2] ^ zobristKeys.pieces[WHITE_ROOKS + us][move.to + 1];
+            score += pieceSquareValues[WHITE_ROOKS + us][move.to + 1] - pieceSquareValues[WHITE_ROOKS + us][move.to - 2];
             state[move.to + 1] = state[move.to - 2];
             state[move.to - 2] = '0';
         } else if (move.flags & EnPassant) {
-            // check for color to determine which direction to capture
-            if (fromPiece == 'P') {
-                state[move.to - 8] = '0';
-            } else {
-                state[move.to + 8] = '0';
-            }
+            const int captureSquare = Color == WHITE ? move.to - 8 : move.to + 8;
+            const uint64_t captureMask = 1ULL << captureSquare;
+            _bitboards[WHITE_PAWNS + them] ^= captureMask;
+            _bitboards[WHITE_ALL_PIECES + them] ^= captureMask;
+            hash ^= zobristKeys.pieces[WHITE_PAWNS + them][captureSquare];
+            score -= pieceSquareValues[WHITE_PAWNS + them][captureSquare];
+            state[captureSquare] = '0';
         } else if (move.flags & IsPromotion) {
-            state[move.to] = color == WHITE ? 'Q' : 'q';
+            const int promotedIdx = WHITE_PAWNS + us + move.promotion() - Pawn;
+            _bitboards[WHITE_PAWNS + us] ^= toMask;
+            _bitboards[promotedIdx] ^= toMask;
+            hash ^= zobristKeys.pieces[WHITE_PAWNS + us][move.to] ^ zobristKeys.pieces[promotedIdx][move.to];
+            score += pieceSquareValues[promotedIdx][move.to] - pieceSquareValues[WHITE_PAWNS + us][move.to];
+            state[move.to] = (Color == WHITE ? "PNBRQK" : "pnbrqk")[move.promotion() - Pawn];
+        }
+        _bitboards[OCCUPANCY] = _bitboards[WHITE_ALL_PIECES].getData() | _bitboards[BLACK_ALL_PIECES].getData();
+        _bitboards[EMPTY_SQUARES] = ~_bitboards[OCCUPANCY].getData();
+
+        // castling rights only ever go away
+        const unsigned char newCastling = castling & castlingMask[move.from] & castlingMask[move.to];
+        hash ^= zobristKeys.castling[castling] ^ zobristKeys.castling[newCastling];
+        castling = newCastling;
+
+        // the en passant square only lives for one reply
+        if (enPassant >= 0) {
+            hash ^= zobristKeys.enPassant[enPassant & 7];
         }
+        enPassant = -1;
+        if (moverIdx == WHITE_PAWNS + us && (move.to - move.from == 16 || move.from - move.to == 16)) {
+            enPassant = (signed char)((move.from + move.to) / 2);
+            hash ^= zobristKeys.enPassant[enPassant & 7];
+        }
+
         // flip the color bit as it now becomes the other player's turn
-        color = (color == WHITE) ? BLACK : WHITE;
+        color = Color == WHITE ? BLACK : WHITE;
+        hash ^= zobristKeys.side;
+        _zobristHash = hash;
+        _score = score;
+        // debug builds make sure the running score never drifts from the board
+        assert(_score == computeScore());
         flags = 0; // invalidate all the flags
     }
 
-    inline void pushState() {
-        assert(stackPtr < MAX_DEPTH);
-        stateStack[stackPtr++] = static_cast<const GameStateData&>(*this);
-    }
-    inline void popState() {
-        assert(stackPtr > 0);
-        static_cast<GameStateData&>(*this) = stateStack[--stackPtr];
-    }
+    // both colors' pieces that attack the square with the given occupancy
+    uint64_t attackersTo(int square, uint64_t occupancy) const;
+    // every square the enemy attacks once our king has stepped off its square
+    template <int Color> uint64_t kingDangerSquares(const MoveMasks& masks);
 
-    std::vector<BitMove> generateAllMoves();
-    void shutdown();
-private:
-    const BitBoard generatePawnAttacks(const BitBoard pawns, char color);
-    uint64_t generatePawnAttacksBitBoard(int square, char color);
-    
-    void generateKnightMoves(std::vector<BitMove>& moves, BitBoard knightBoard, uint64_t occupancy);
-    void generateKingMoves(std::vector<BitMove>& moves, BitBoard kingBoard, uint64_t occupancy);
-    void generateRooksMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t friendlies);
-    void generateQueensMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t friendlies);
-
-    void generateBishopMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t friendlies);
-    void generatePawnMoveList(std::vector<BitMove>& moves, const BitBoard pawns, const BitBoard emptySquares, const BitBoard enemyPieces, char color);
-    void addPawnBitboardMovesToList(std::vector<BitMove>& moves, const BitBoard bitboard, const int shift);
-    bool isSquareAttacked(int square, char attackerColor, const BitBoard (&boards)[e_numBitboards]);
-    void filterOutIllegalMoves(std::vector<BitMove>& moves);
+    // pinned pieces stay on the line through the king, everything else goes anywhere in targets
+    uint64_t pinRestriction(int fromSquare, const MoveMasks& masks) const;
+    void generateKnightMoves(MoveList& moves, BitBoard knightBoard, const MoveMasks& masks, uint64_t targets);
+    template <int Color> void generateKingMoves(MoveList& moves, const MoveMasks& masks, uint64_t targets, uint64_t attacked);
+    template <int Color> void generateCastles(MoveList& moves, const MoveMasks& masks, uint64_t attacked);
+    void generateRooksMoves(MoveList& moves, BitBoard rookBoard, const MoveMasks& masks, uint64_t targets);
+    void generateQueensMoves(MoveList& moves, BitBoard queenBoard, const MoveMasks& masks, uint64_t targets);
+    void generateBishopMoves(MoveList& moves, BitBoard bishopBoard, const MoveMasks& masks, uint64_t targets);
+    template <int Color> void generatePawnMoveList(MoveList& moves, const BitBoard pawns, const MoveMasks& masks, MoveGenType type);
+    void addPawnMove(MoveList& moves, int fromSquare, int toSquare, int flags);
+    template <int Color> bool enPassantIsLegal(int fromSquare, const MoveMasks& masks) const;
+    // friendly squares are already masked out, anything left on the target square is a capture
+    inline int captureFlag(int toSquare) const { return state[toSquare] != '0' ? IsCapture : 0; }
+
+    // one pair of attack maps per position on the stack. a move clears the cached flags, and unmakeMove or
+    // popState put the parent's flags back along with stackPtr, so its maps are still right where it left them
+    AttackMap _attackMaps[MAX_PLY + 1][2];
 
 };
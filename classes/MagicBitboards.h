@@ -2,9 +2,18 @@
 #define MAGIC_BITBOARDS_H
 
 #include <stdint.h>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 // Generate rook attacks for a given square and blocking pieces
-static inline uint64_t ratt(int sq, uint64_t block) {
+static constexpr inline uint64_t ratt(int sq, uint64_t block) {
     uint64_t result = 0ULL;
     int rk = sq / 8, fl = sq % 8, r, f;
 
@@ -32,7 +41,7 @@ static inline uint64_t ratt(int sq, uint64_t block) {
 }
 
 // Generate bishop attacks for a given square and blocking pieces
-static inline uint64_t batt(int sq, uint64_t block) {
+static constexpr inline uint64_t batt(int sq, uint64_t block) {
     uint64_t result = 0ULL;
     int rk = sq / 8, fl = sq % 8, r, f;
 
@@ -95,7 +104,7 @@ static inline uint64_t batt(int sq, uint64_t block) {
 #endif
 
 // Convert index to bitboard configuration
-static inline uint64_t indexToUint64(int index, int bits, uint64_t m) {
+static constexpr inline uint64_t indexToUint64(int index, int bits, uint64_t m) {
     uint64_t result = 0ULL;
     for (int i = 0; i < bits; i++) {
         uint64_t least_bit = m & -m;  // get least significant bit
@@ -128,7 +137,7 @@ static inline uint64_t indexToUint64(int index, int bits, uint64_t m) {
 #define BLACK_PAWN_ATTACKS(pawns) (SOUTH_EAST(pawns) | SOUTH_WEST(pawns))
 
 // Size of attack tables for each square
-const int RAttackSize[64] = {
+constexpr int RAttackSize[64] = {
   4096,
   2048,
   2048,
@@ -195,7 +204,7 @@ const int RAttackSize[64] = {
   4096,
 };
 
-const int BAttackSize[64] = {
+constexpr int BAttackSize[64] = {
   64,
   32,
   32,
@@ -262,12 +271,8 @@ const int BAttackSize[64] = {
   64,
 };
 
-// Attack lookup tables
-static uint64_t* RAttacks[64];
-static uint64_t* BAttacks[64];
-
 // Magic bitboard shift amounts
-const int RShifts[64] = {
+constexpr int RShifts[64] = {
   52,
   53,
   53,
@@ -334,7 +339,7 @@ const int RShifts[64] = {
   52,
 };
 
-const int BShifts[64] = {
+constexpr int BShifts[64] = {
   58,
   59,
   59,
@@ -402,7 +407,7 @@ const int BShifts[64] = {
 };
 
 // Magic numbers for rooks
-const uint64_t RMagic[64] = {
+constexpr uint64_t RMagic[64] = {
   0xa8002c000108020ULL,
   0x6c00049b0002001ULL,
   0x100200010090040ULL,
@@ -470,7 +475,7 @@ const uint64_t RMagic[64] = {
 };
 
 // Magic numbers for bishops
-const uint64_t BMagic[64] = {
+constexpr uint64_t BMagic[64] = {
   0x89a1121896040240ULL,
   0x2004844802002010ULL,
   0x2068080051921000ULL,
@@ -538,7 +543,7 @@ const uint64_t BMagic[64] = {
 };
 
 // Attack masks for each square
-const uint64_t RMasks[64] = {
+constexpr uint64_t RMasks[64] = {
   0x101010101017eULL,
   0x202020202027cULL,
   0x404040404047aULL,
@@ -605,7 +610,7 @@ const uint64_t RMasks[64] = {
   0x7e80808080808000ULL,
 };
 
-const uint64_t BMasks[64] = {
+constexpr uint64_t BMasks[64] = {
   0x40201008040200ULL,
   0x402010080400ULL,
   0x4020100a00ULL,
@@ -672,202 +677,329 @@ const uint64_t BMasks[64] = {
   0x40201008040200ULL,
 };
 
-// Pre-calculated knight attack bitboards
-const uint64_t KnightAttacks[64] = {
-  0x20400ULL,
-  0x50800ULL,
-  0xa1100ULL,
-  0x142200ULL,
-  0x284400ULL,
-  0x508800ULL,
-  0xa01000ULL,
-  0x402000ULL,
-  0x2040004ULL,
-  0x5080008ULL,
-  0xa110011ULL,
-  0x14220022ULL,
-  0x28440044ULL,
-  0x50880088ULL,
-  0xa0100010ULL,
-  0x40200020ULL,
-  0x204000402ULL,
-  0x508000805ULL,
-  0xa1100110aULL,
-  0x1422002214ULL,
-  0x2844004428ULL,
-  0x5088008850ULL,
-  0xa0100010a0ULL,
-  0x4020002040ULL,
-  0x20400040200ULL,
-  0x50800080500ULL,
-  0xa1100110a00ULL,
-  0x142200221400ULL,
-  0x284400442800ULL,
-  0x508800885000ULL,
-  0xa0100010a000ULL,
-  0x402000204000ULL,
-  0x2040004020000ULL,
-  0x5080008050000ULL,
-  0xa1100110a0000ULL,
-  0x14220022140000ULL,
-  0x28440044280000ULL,
-  0x50880088500000ULL,
-  0xa0100010a00000ULL,
-  0x40200020400000ULL,
-  0x204000402000000ULL,
-  0x508000805000000ULL,
-  0xa1100110a000000ULL,
-  0x1422002214000000ULL,
-  0x2844004428000000ULL,
-  0x5088008850000000ULL,
-  0xa0100010a0000000ULL,
-  0x4020002040000000ULL,
-  0x400040200000000ULL,
-  0x800080500000000ULL,
-  0x1100110a00000000ULL,
-  0x2200221400000000ULL,
-  0x4400442800000000ULL,
-  0x8800885000000000ULL,
-  0x100010a000000000ULL,
-  0x2000204000000000ULL,
-  0x4020000000000ULL,
-  0x8050000000000ULL,
-  0x110a0000000000ULL,
-  0x22140000000000ULL,
-  0x44280000000000ULL,
-  0x88500000000000ULL,
-  0x10a00000000000ULL,
-  0x20400000000000ULL,
+// Every attack table the move generator needs, built by the compiler so there's nothing to
+// initialize or free at runtime. It's one block: the magic rook and bishop tables share a single
+// array, with per-square offsets into it instead of a heap allocation per square.
+constexpr int sumAttackSizes(const int* sizes) {
+    int total = 0;
+    for (int square = 0; square < 64; square++) {
+        total += sizes[square];
+    }
+    return total;
+}
+
+constexpr int RookTableSize = sumAttackSizes(RAttackSize);
+constexpr int BishopTableSize = sumAttackSizes(BAttackSize);
+
+struct AttackTables {
+    uint64_t sliders[RookTableSize + BishopTableSize];
+    // the same attacks indexed by pext(occupied, mask) instead of the magic multiply. our magics use exactly
+    // one slot per subset, so the pext tables are the same size and share the offsets
+    uint64_t pextSliders[RookTableSize + BishopTableSize];
+    int rookOffset[64];
+    int bishopOffset[64];
+    uint64_t knight[64];
+    uint64_t king[64];
+    uint64_t pawn[2][64];           // white then black
+    // for two squares on a shared rank, file or diagonal: the squares strictly between them, and the whole line through both
+    uint64_t between[64][64];
+    uint64_t line[64][64];
 };
 
-// Pre-calculated king attack bitboards
-const uint64_t KingAttacks[64] = {
-  0x302ULL,
-  0x705ULL,
-  0xe0aULL,
-  0x1c14ULL,
-  0x3828ULL,
-  0x7050ULL,
-  0xe0a0ULL,
-  0xc040ULL,
-  0x30203ULL,
-  0x70507ULL,
-  0xe0a0eULL,
-  0x1c141cULL,
-  0x382838ULL,
-  0x705070ULL,
-  0xe0a0e0ULL,
-  0xc040c0ULL,
-  0x3020300ULL,
-  0x7050700ULL,
-  0xe0a0e00ULL,
-  0x1c141c00ULL,
-  0x38283800ULL,
-  0x70507000ULL,
-  0xe0a0e000ULL,
-  0xc040c000ULL,
-  0x302030000ULL,
-  0x705070000ULL,
-  0xe0a0e0000ULL,
-  0x1c141c0000ULL,
-  0x3828380000ULL,
-  0x7050700000ULL,
-  0xe0a0e00000ULL,
-  0xc040c00000ULL,
-  0x30203000000ULL,
-  0x70507000000ULL,
-  0xe0a0e000000ULL,
-  0x1c141c000000ULL,
-  0x382838000000ULL,
-  0x705070000000ULL,
-  0xe0a0e0000000ULL,
-  0xc040c0000000ULL,
-  0x3020300000000ULL,
-  0x7050700000000ULL,
-  0xe0a0e00000000ULL,
-  0x1c141c00000000ULL,
-  0x38283800000000ULL,
-  0x70507000000000ULL,
-  0xe0a0e000000000ULL,
-  0xc040c000000000ULL,
-  0x302030000000000ULL,
-  0x705070000000000ULL,
-  0xe0a0e0000000000ULL,
-  0x1c141c0000000000ULL,
-  0x3828380000000000ULL,
-  0x7050700000000000ULL,
-  0xe0a0e00000000000ULL,
-  0xc040c00000000000ULL,
-  0x203000000000000ULL,
-  0x507000000000000ULL,
-  0xa0e000000000000ULL,
-  0x141c000000000000ULL,
-  0x2838000000000000ULL,
-  0x5070000000000000ULL,
-  0xa0e0000000000000ULL,
-  0x40c0000000000000ULL,
+constexpr AttackTables buildAttackTables() {
+    AttackTables tables{};
+
+    // magic rook then bishop tables, back to back. the carry-rippler walks every subset of the mask in pext
+    // order, it's a lot cheaper than indexToUint64 and the compiler has an operation budget for all this
+    int offset = 0;
+    for (int square = 0; square < 64; square++) {
+        tables.rookOffset[square] = offset;
+        const uint64_t mask = RMasks[square];
+        uint64_t subset = 0;
+        int index = 0;
+        do {
+            const uint64_t attacks = ratt(square, subset);
+            tables.sliders[offset + ((subset * RMagic[square]) >> RShifts[square])] = attacks;
+            tables.pextSliders[offset + index++] = attacks;
+            subset = (subset - mask) & mask;
+        } while (subset);
+        offset += RAttackSize[square];
+    }
+    for (int square = 0; square < 64; square++) {
+        tables.bishopOffset[square] = offset;
+        const uint64_t mask = BMasks[square];
+        uint64_t subset = 0;
+        int index = 0;
+        do {
+            const uint64_t attacks = batt(square, subset);
+            tables.sliders[offset + ((subset * BMagic[square]) >> BShifts[square])] = attacks;
+            tables.pextSliders[offset + index++] = attacks;
+            subset = (subset - mask) & mask;
+        } while (subset);
+        offset += BAttackSize[square];
+    }
+
+    for (int square = 0; square < 64; square++) {
+        const uint64_t bit = 1ULL << square;
+        const uint64_t horizontal = EAST(bit) | WEST(bit);
+        const uint64_t vertical = NORTH(bit) | SOUTH(bit);
+        tables.king[square] = horizontal | vertical | NORTH_EAST(bit) | NORTH_WEST(bit) | SOUTH_EAST(bit) | SOUTH_WEST(bit);
+        tables.knight[square] = NORTH(NORTH(horizontal)) | SOUTH(SOUTH(horizontal)) |
+                                EAST(EAST(vertical)) | WEST(WEST(vertical));
+        tables.pawn[0][square] = WHITE_PAWN_ATTACKS(bit);
+        tables.pawn[1][square] = BLACK_PAWN_ATTACKS(bit);
+    }
+
+    uint64_t rookRays[64] = {};
+    uint64_t bishopRays[64] = {};
+    for (int square = 0; square < 64; square++) {
+        rookRays[square] = ratt(square, 0);
+        bishopRays[square] = batt(square, 0);
+    }
+    for (int a = 0; a < 64; a++) {
+        for (int b = 0; b < 64; b++) {
+            const uint64_t bitA = 1ULL << a;
+            const uint64_t bitB = 1ULL << b;
+            if (rookRays[a] & bitB) {
+                tables.between[a][b] = ratt(a, bitB) & ratt(b, bitA);
+                tables.line[a][b] = (rookRays[a] & rookRays[b]) | bitA | bitB;
+            } else if (bishopRays[a] & bitB) {
+                tables.between[a][b] = batt(a, bitB) & batt(b, bitA);
+                tables.line[a][b] = (bishopRays[a] & bishopRays[b]) | bitA | bitB;
+            }
+        }
+    }
+    return tables;
+}
+
+inline constexpr AttackTables attackTables = buildAttackTables();
+
+// BMI2 pext gathers the masked occupancy bits straight into a table index, no multiply or shift
+static inline bool cpuHasBmi2() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2");
+#elif defined(_M_X64)
+    int info[4];
+    __cpuidex(info, 7, 0);
+    return (info[1] >> 8) & 1;
+#else
+    return false;
+#endif
+}
+
+static inline uint64_t pext(uint64_t bits, uint64_t mask) {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    // inline asm rather than _pext_u64 so it still inlines into code built without -mbmi2,
+    // it only ever runs once cpuHasBmi2() has said yes
+    uint64_t result;
+    asm("pextq %2, %1, %0" : "=r"(result) : "r"(bits), "r"(mask));
+    return result;
+#elif defined(_M_X64)
+    return _pext_u64(bits, mask);
+#else
+    return 0;
+#endif
+}
+
+// bmi2 alone doesn't mean pext is fast. AMD before Zen 3 (family 19h) runs it in microcode at dozens of
+// cycles or worse depending on the mask, slower than a magic multiply and shift
+static inline bool cpuHasFastPext() {
+    if (!cpuHasBmi2()) {
+        return false;
+    }
+    unsigned int vendor[3];
+    unsigned int signature;
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    unsigned int eax, ebx, ecx, edx;
+    __cpuid(0, eax, ebx, ecx, edx);
+    vendor[0] = ebx;
+    vendor[1] = edx;
+    vendor[2] = ecx;
+    __cpuid(1, eax, ebx, ecx, edx);
+    signature = eax;
+#elif defined(_M_X64)
+    int info[4];
+    __cpuid(info, 0);
+    vendor[0] = info[1];
+    vendor[1] = info[3];
+    vendor[2] = info[2];
+    __cpuid(info, 1);
+    signature = info[0];
+#else
+    return false;
+#endif
+    // "AuthenticAMD", four characters to a register. Hygon's family 18h parts are Zen 1 underneath
+    const bool amd = (vendor[0] == 0x68747541 && vendor[1] == 0x69746e65 && vendor[2] == 0x444d4163) ||
+                     (vendor[0] == 0x6f677948 && vendor[1] == 0x6e65476e && vendor[2] == 0x656e6975);
+    unsigned int family = (signature >> 8) & 0xF;
+    if (family == 0xF) {
+        family += (signature >> 20) & 0xFF;
+    }
+    return !(amd && family < 0x19);
+}
+
+enum SliderBackend {
+    SliderMagic,
+    SliderPext
 };
 
+// picked once at startup from CPUID, pext wherever it runs in hardware. the tools can force either one
+inline SliderBackend sliderBackend = cpuHasFastPext() ? SliderPext : SliderMagic;
+
+// false if pext was asked for on a CPU without bmi2, a slow pext is still allowed so it can be measured
+static inline bool setSliderBackend(SliderBackend backend) {
+    if (backend == SliderPext && !cpuHasBmi2()) {
+        return false;
+    }
+    sliderBackend = backend;
+    return true;
+}
+
 // Helper functions for move generation
 static inline uint64_t getRookAttacks(int square, uint64_t occupied) {
+    if (sliderBackend == SliderPext) {
+        return attackTables.pextSliders[attackTables.rookOffset[square] + pext(occupied, RMasks[square])];
+    }
     occupied &= RMasks[square];
     occupied *= RMagic[square];
     occupied >>= RShifts[square];
-    return RAttacks[square][occupied];
+    return attackTables.sliders[attackTables.rookOffset[square] + occupied];
 }
 
 static inline uint64_t getBishopAttacks(int square, uint64_t occupied) {
+    if (sliderBackend == SliderPext) {
+        return attackTables.pextSliders[attackTables.bishopOffset[square] + pext(occupied, BMasks[square])];
+    }
     occupied &= BMasks[square];
     occupied *= BMagic[square];
     occupied >>= BShifts[square];
-    return BAttacks[square][occupied];
+    return attackTables.sliders[attackTables.bishopOffset[square] + occupied];
 }
 
 static inline uint64_t getQueenAttacks(int square, uint64_t occupied) {
     return getRookAttacks(square, occupied) | getBishopAttacks(square, occupied);
 }
 
-// Initialize magic bitboards
-void initMagicBitboards(void) {
-    int square, i;
-    uint64_t subset, index;
-
-    // Initialize rook attack tables
-    for (square = 0; square < 64; square++) {
-        RAttacks[square] = new uint64_t[RAttackSize[square]];
-        uint64_t mask = RMasks[square];
-        int bits = countOnes(mask);
-        int n = 1 << bits;
-
-        for (i = 0; i < n; i++) {
-            subset = indexToUint64(i, bits, mask);
-            index = (subset * RMagic[square]) >> RShifts[square];
-            RAttacks[square][index] = ratt(square, subset);
-        }
+// Setwise attacks: Kogge-Stone occluded fills slide a whole set of pieces at once, so a side's attack
+// map doesn't need a lookup per piece. A fill shifts the sliders one step along a direction, then two,
+// then four, only ever through empty squares, so three steps cover the board.
+// north, east, north east, north west shift left by these, south, west, south west, south east shift right.
+// the wrap masks stop east-going fills coming back in on the a file and west-going ones on the h file
+constexpr int FillShifts[4] = { 8, 1, 9, 7 };
+constexpr uint64_t LeftFillWraps[4] = { ~0ULL, 0xfefefefefefefefeULL, 0xfefefefefefefefeULL, 0x7f7f7f7f7f7f7f7fULL };
+constexpr uint64_t RightFillWraps[4] = { ~0ULL, 0x7f7f7f7f7f7f7f7fULL, 0x7f7f7f7f7f7f7f7fULL, 0xfefefefefefefefeULL };
+
+struct SlidingAttacks {
+    uint64_t orthogonal;            // everything the rook movers attack
+    uint64_t diagonal;              // everything the bishop movers attack
+};
+
+static inline SlidingAttacks slidingAttacksScalar(uint64_t rooks, uint64_t bishops, uint64_t occupied) {
+    const uint64_t empty = ~occupied;
+    uint64_t attacks[4];
+    for (int lane = 0; lane < 4; lane++) {
+        const int shift = FillShifts[lane];
+        const uint64_t sliders = lane < 2 ? rooks : bishops;
+
+        uint64_t gen = sliders;
+        uint64_t pro = empty & LeftFillWraps[lane];
+        gen |= pro & (gen << shift);
+        pro &= pro << shift;
+        gen |= pro & (gen << (2 * shift));
+        pro &= pro << (2 * shift);
+        gen |= pro & (gen << (4 * shift));
+        attacks[lane] = (gen << shift) & LeftFillWraps[lane];
+
+        gen = sliders;
+        pro = empty & RightFillWraps[lane];
+        gen |= pro & (gen >> shift);
+        pro &= pro >> shift;
+        gen |= pro & (gen >> (2 * shift));
+        pro &= pro >> (2 * shift);
+        gen |= pro & (gen >> (4 * shift));
+        attacks[lane] |= (gen >> shift) & RightFillWraps[lane];
     }
+    return { attacks[0] | attacks[1], attacks[2] | attacks[3] };
+}
 
-    // Initialize bishop attack tables
-    for (square = 0; square < 64; square++) {
-        BAttacks[square] = new uint64_t[BAttackSize[square]];
-        uint64_t mask = BMasks[square];
-        int bits = countOnes(mask);
-        int n = 1 << bits;
-
-        for (i = 0; i < n; i++) {
-            subset = indexToUint64(i, bits, mask);
-            index = (subset * BMagic[square]) >> BShifts[square];
-            BAttacks[square][index] = batt(square, subset);
-        }
+#if defined(__x86_64__) || defined(_M_X64)
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+// the same fills with the four directions side by side in one register, each lane has its own shift
+AVX2_TARGET static SlidingAttacks slidingAttacksAvx2(uint64_t rooks, uint64_t bishops, uint64_t occupied) {
+    const __m256i shift1 = _mm256_setr_epi64x(FillShifts[0], FillShifts[1], FillShifts[2], FillShifts[3]);
+    const __m256i shift2 = _mm256_add_epi64(shift1, shift1);
+    const __m256i shift4 = _mm256_add_epi64(shift2, shift2);
+    const __m256i sliders = _mm256_setr_epi64x((long long)rooks, (long long)rooks, (long long)bishops, (long long)bishops);
+    const __m256i empty = _mm256_set1_epi64x((long long)~occupied);
+    const __m256i leftWraps = _mm256_setr_epi64x((long long)LeftFillWraps[0], (long long)LeftFillWraps[1],
+                                                 (long long)LeftFillWraps[2], (long long)LeftFillWraps[3]);
+    const __m256i rightWraps = _mm256_setr_epi64x((long long)RightFillWraps[0], (long long)RightFillWraps[1],
+                                                  (long long)RightFillWraps[2], (long long)RightFillWraps[3]);
+
+    __m256i gen = sliders;
+    __m256i pro = _mm256_and_si256(empty, leftWraps);
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_sllv_epi64(gen, shift1)));
+    pro = _mm256_and_si256(pro, _mm256_sllv_epi64(pro, shift1));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_sllv_epi64(gen, shift2)));
+    pro = _mm256_and_si256(pro, _mm256_sllv_epi64(pro, shift2));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_sllv_epi64(gen, shift4)));
+    const __m256i left = _mm256_and_si256(_mm256_sllv_epi64(gen, shift1), leftWraps);
+
+    gen = sliders;
+    pro = _mm256_and_si256(empty, rightWraps);
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srlv_epi64(gen, shift1)));
+    pro = _mm256_and_si256(pro, _mm256_srlv_epi64(pro, shift1));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srlv_epi64(gen, shift2)));
+    pro = _mm256_and_si256(pro, _mm256_srlv_epi64(pro, shift2));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srlv_epi64(gen, shift4)));
+    const __m256i right = _mm256_and_si256(_mm256_srlv_epi64(gen, shift1), rightWraps);
+
+    alignas(32) uint64_t attacks[4];
+    _mm256_store_si256((__m256i*)attacks, _mm256_or_si256(left, right));
+    return { attacks[0] | attacks[1], attacks[2] | attacks[3] };
+}
+#endif
+
+static inline bool cpuHasAvx2() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_M_X64)
+    // the cpu has to have it and the OS has to save the ymm registers
+    int info[4];
+    __cpuid(info, 1);
+    if (!((info[2] >> 27) & 1) || (_xgetbv(0) & 6) != 6) {
+        return false;
     }
+    __cpuidex(info, 7, 0);
+    return (info[1] >> 5) & 1;
+#else
+    return false;
+#endif
 }
 
-// Cleanup magic bitboard tables
-void cleanupMagicBitboards(void) {
-    int square;
-    for (square = 0; square < 64; square++) {
-        delete[] RAttacks[square];
-        delete[] BAttacks[square];
+inline const bool useAvx2Fills = cpuHasAvx2();
+
+static inline SlidingAttacks slidingAttacks(uint64_t rooks, uint64_t bishops, uint64_t occupied) {
+#if defined(__x86_64__) || defined(_M_X64)
+    if (useAvx2Fills) {
+        return slidingAttacksAvx2(rooks, bishops, occupied);
     }
+#endif
+    return slidingAttacksScalar(rooks, bishops, occupied);
+}
+
+// every square a set of knights attacks
+static inline uint64_t knightAttacks(uint64_t knights) {
+    const uint64_t one = ((knights << 1) & 0xfefefefefefefefeULL) | ((knights >> 1) & 0x7f7f7f7f7f7f7f7fULL);
+    const uint64_t two = ((knights << 2) & 0xfcfcfcfcfcfcfcfcULL) | ((knights >> 2) & 0x3f3f3f3f3f3f3f3fULL);
+    return (one << 16) | (one >> 16) | (two << 8) | (two >> 8);
 }
 
 #endif // MAGIC_BITBOARDS_H
@@ -0,0 +1,227 @@
+#include "MovePicker.h"
+#include <algorithm>
+
+// captures by most valuable victim / least valuable attacker, queen promotions just behind them
+constexpr int CAPTURE_SCORE = 1 << 16;
+constexpr int PROMOTION_SCORE = CAPTURE_SCORE - 1;
+// indexed by ChessPiece, the king only ever shows up as an attacker
+static const int mvvLvaValue[7] = { 0, 1, 3, 3, 5, 9, 20 };
+
+int victimPiece(const GameState& gameState, const BitMove& move)
+{
+    if (move.flags & EnPassant) {
+        return Pawn;
+    }
+    const int board = bitboardLookup[(unsigned char)gameState.state[move.to]];
+    return (board % BLACK_PAWNS) + 1;
+}
+
+template <int Color>
+MovePicker<Color>::MovePicker(GameState& gameState, uint16_t hashMove, const BitMove* killers, uint16_t counterMove,
+                              const QuietHistory* history)
+    : _gameState(gameState)
+    , _stage(HashMoveStage)
+    , _capturesOnly(false)
+    , _skipQuiets(false)
+    , _hashMove(hashMove)
+    , _counterMove(counterMove)
+    , _history(history)
+    , _killerIndex(0)
+    , _index(0)
+    , _badIndex(0)
+{
+    _gameState.computeMoveMasks<Color>(_masks);
+    for (int i = 0; i < NUM_KILLERS; i++) {
+        _killers[i] = killers ? packMove(killers[i]) : 0;
+    }
+}
+
+template <int Color>
+MovePicker<Color>::MovePicker(GameState& gameState)
+    : _gameState(gameState)
+    , _stage(GenerateCapturesStage)
+    , _hashMove(0)
+    , _counterMove(0)
+    , _history(nullptr)
+    , _killerIndex(0)
+    , _index(0)
+    , _badIndex(0)
+{
+    _gameState.computeMoveMasks<Color>(_masks);
+    _capturesOnly = !inCheck();
+    _skipQuiets = false;
+    for (int i = 0; i < NUM_KILLERS; i++) {
+        _killers[i] = 0;
+    }
+}
+
+template <int Color>
+void MovePicker<Color>::scoreCaptures()
+{
+    for (int i = 0; i < _moves.size(); i++) {
+        const BitMove& move = _moves[i];
+        int score = 0;
+        if (move.flags & IsCapture) {
+            score = CAPTURE_SCORE + mvvLvaValue[victimPiece(_gameState, move)] * 32 - mvvLvaValue[move.piece];
+        } else if (move.promotion() == Queen) {
+            score = PROMOTION_SCORE;
+        }
+        // underpromotions are rarely right, they go last
+        _scores[i] = score;
+    }
+}
+
+template <int Color>
+void MovePicker<Color>::scoreQuiets()
+{
+    constexpr int us = Color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    for (int i = 0; i < _moves.size(); i++) {
+        const BitMove& move = _moves[i];
+        _scores[i] = _history ? _history->butterfly[us + move.piece - Pawn][move.to] : 0;
+    }
+}
+
+template <int Color>
+void MovePicker<Color>::pickBest()
+{
+    int best = _index;
+    for (int i = _index + 1; i < _moves.size(); i++) {
+        if (_scores[i] > _scores[best]) {
+            best = i;
+        }
+    }
+    if (best != _index) {
+        std::swap(_moves[_index], _moves[best]);
+        std::swap(_scores[_index], _scores[best]);
+    }
+}
+
+template <int Color>
+bool MovePicker<Color>::alreadyTried(const BitMove& move) const
+{
+    const uint16_t packed = packMove(move);
+    return packed == _hashMove || packed == _counterMove || isKiller(packed);
+}
+
+template <int Color>
+bool MovePicker<Color>::isKiller(uint16_t packed) const
+{
+    for (int i = 0; i < NUM_KILLERS; i++) {
+        if (packed == _killers[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <int Color>
+bool MovePicker<Color>::next(BitMove& move)
+{
+    if (_skipQuiets && _stage >= KillersStage && _stage < BadCapturesStage) {
+        _stage = BadCapturesStage;
+    }
+    switch (_stage) {
+        case HashMoveStage:
+            _stage = GenerateCapturesStage;
+            // the hash move came from another position with the same key bits, it has to prove it's legal here
+            if (_gameState.moveFromPacked<Color>(_hashMove, _masks, move)) {
+                return true;
+            }
+            _hashMove = 0;
+            [[fallthrough]];
+
+        case GenerateCapturesStage:
+            _gameState.generateMoves<Color>(_moves, _masks, GenCaptures);
+            scoreCaptures();
+            _index = 0;
+            _stage = CapturesStage;
+            [[fallthrough]];
+
+        case CapturesStage:
+            while (_index < _moves.size()) {
+                pickBest();
+                move = _moves[_index++];
+                if (packMove(move) == _hashMove) {
+                    continue;
+                }
+                if (_capturesOnly && (move.flags & PromotionPieceMask)) {
+                    continue;
+                }
+                // a capture that loses material once the exchange plays out waits until after the quiet moves
+                if (!_capturesOnly && (move.flags & IsCapture) && !_gameState.see(move, 0)) {
+                    _badCaptures.push_back(move);
+                    continue;
+                }
+                return true;
+            }
+            if (_capturesOnly) {
+                _stage = DoneStage;
+                return false;
+            }
+            if (_skipQuiets) {
+                _stage = BadCapturesStage;
+                return next(move);
+            }
+            _stage = KillersStage;
+            [[fallthrough]];
+
+        case KillersStage:
+            while (_killerIndex < NUM_KILLERS) {
+                const int killer = _killerIndex++;
+                // a killer has to be a legal quiet move here, and not one we've already played
+                if (_killers[killer] && _killers[killer] != _hashMove &&
+                    _gameState.moveFromPacked<Color>(_killers[killer], _masks, move) &&
+                    !(move.flags & (IsCapture | IsPromotion))) {
+                    return true;
+                }
+                _killers[killer] = 0;
+            }
+            _stage = CounterMoveStage;
+            [[fallthrough]];
+
+        case CounterMoveStage:
+            _stage = GenerateQuietsStage;
+            // the same rules as a killer, and it may well be one already
+            if (_counterMove && _counterMove != _hashMove && !isKiller(_counterMove) &&
+                _gameState.moveFromPacked<Color>(_counterMove, _masks, move) &&
+                !(move.flags & (IsCapture | IsPromotion))) {
+                return true;
+            }
+            _counterMove = 0;
+            [[fallthrough]];
+
+        case GenerateQuietsStage:
+            _gameState.generateMoves<Color>(_moves, _masks, GenQuiets);
+            scoreQuiets();
+            _index = 0;
+            _stage = QuietsStage;
+            [[fallthrough]];
+
+        case QuietsStage:
+            while (_index < _moves.size()) {
+                pickBest();
+                move = _moves[_index++];
+                if (alreadyTried(move)) {
+                    continue;
+                }
+                return true;
+            }
+            _stage = BadCapturesStage;
+            [[fallthrough]];
+
+        case BadCapturesStage:
+            if (_badIndex < _badCaptures.size()) {
+                move = _badCaptures[_badIndex++];
+                return true;
+            }
+            _stage = DoneStage;
+            [[fallthrough]];
+
+        case DoneStage:
+            break;
+    }
+    return false;
+}
+
+template class MovePicker<WHITE>;
+template class MovePicker<BLACK>;
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "GameState.h"
+#include "TranspositionTable.h"
+
+// quiet moves that caused a cutoff at the same ply elsewhere in the tree
+constexpr int NUM_KILLERS = 2;
+
+// the piece a capture takes, a pawn for en passant
+int victimPiece(const GameState& gameState, const BitMove& move);
+
+// history scores stay inside +-MAX_HISTORY, the gravity update slows down as an entry closes in on it
+constexpr int MAX_HISTORY = 16384;
+
+// what the search has learned about quiet moves, each search thread keeps its own
+struct QuietHistory {
+    // how often a quiet move has cut off, by the mover's bitboard index and its destination
+    int16_t butterfly[e_numBitboards][64];
+    // the quiet move that last refuted a move, by that move's piece (bitboard index) and destination, packed
+    uint16_t counterMoves[e_numBitboards][64];
+
+    void clear() {
+        std::memset(butterfly, 0, sizeof(butterfly));
+        std::memset(counterMoves, 0, sizeof(counterMoves));
+    }
+    // a bonus for a cutoff, a malus for a quiet move that was searched and didn't cut. entries that
+    // are already large move less, so old lessons fade as new ones come in
+    void update(int piece, int toSquare, int bonus) {
+        int16_t& entry = butterfly[piece][toSquare];
+        entry = (int16_t)(entry + bonus - entry * std::abs(bonus) / MAX_HISTORY);
+    }
+};
+
+// hands out a node's legal moves one stage at a time. the hash move comes first, before anything is generated,
+// then captures and promotions by MVV-LVA, then the killers and the countermove, then the rest of
+// the quiet moves by history score, and last the captures that lose material on the exchange.
+// most nodes cut off early, so the quiet moves are never generated at all.
+// Color is the side to move, so the generator calls underneath carry no color branches
+template <int Color>
+class MovePicker {
+public:
+    // the main search, killers and history may be null and the countermove zero
+    MovePicker(GameState& gameState, uint16_t hashMove, const BitMove* killers, uint16_t counterMove, const QuietHistory* history);
+    // quiescence, captures and queen promotions only. in check every evasion is needed so nothing is skipped.
+    // losing captures aren't held back here, quiescence decides what to do with them
+    explicit MovePicker(GameState& gameState);
+
+    // false once every move has been handed out
+    bool next(BitMove& move);
+    bool inCheck() const { return _masks.checkers != 0; }
+    // late move pruning has seen enough, only the losing captures that are left get handed out from here
+    void skipQuiets() { _skipQuiets = true; }
+
+private:
+    enum Stage {
+        HashMoveStage,
+        GenerateCapturesStage,
+        CapturesStage,
+        KillersStage,
+        CounterMoveStage,
+        GenerateQuietsStage,
+        QuietsStage,
+        BadCapturesStage,
+        DoneStage
+    };
+
+    void scoreCaptures();
+    void scoreQuiets();
+    // one step of a selection sort, a cutoff after a move or two leaves the rest unsorted
+    void pickBest();
+    bool alreadyTried(const BitMove& move) const;
+    bool isKiller(uint16_t packed) const;
+
+    GameState& _gameState;
+    GameState::MoveMasks _masks;
+    int _stage;
+    bool _capturesOnly;
+    bool _skipQuiets;
+    uint16_t _hashMove;                 // zero if there isn't one or it isn't legal here
+    uint16_t _killers[NUM_KILLERS];     // packed, zero once found not to be playable
+    uint16_t _counterMove;              // the same
+    const QuietHistory* _history;
+    int _killerIndex;
+    MoveList _moves;
+    int _scores[MAX_MOVES];
+    int _index;
+    MoveList _badCaptures;              // held back by the capture stage, in the order it picked them
+    int _badIndex;
+};
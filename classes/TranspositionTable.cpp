@@ -0,0 +1,122 @@
+#include "TranspositionTable.h"
+
+TranspositionTable::TranspositionTable() : _buckets(nullptr), _bucketCount(0), _age(0)
+{
+    resize(DEFAULT_HASH_MB);
+}
+
+TranspositionTable::~TranspositionTable()
+{
+    delete[] _buckets;
+}
+
+void TranspositionTable::resize(int megabytes)
+{
+    delete[] _buckets;
+    _buckets = nullptr;
+    _bucketCount = 0;
+    if (megabytes <= 0) {
+        return;
+    }
+
+    uint64_t bytes = (uint64_t)megabytes << 20;
+    uint64_t count = 1;
+    while ((count << 1) * sizeof(TTBucket) <= bytes) {
+        count <<= 1;
+    }
+    _buckets = new TTBucket[count];
+    _bucketCount = count;
+    clear();
+}
+
+void TranspositionTable::clear()
+{
+    for (uint64_t b = 0; b < _bucketCount; b++) {
+        for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+            _buckets[b].entries[i].store(0, std::memory_order_relaxed);
+        }
+    }
+    _age = 0;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry& entry) const
+{
+    if (!_bucketCount) {
+        return false;
+    }
+    const uint16_t key16 = (uint16_t)(key >> 48);
+    const TTBucket* bucket = bucketFor(key);
+    for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+        const TTEntry candidate = bucket->load(i);
+        if (candidate.key16 == key16 && candidate.bound() != BoundNone) {
+            entry = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, uint16_t move, int score, int depth, int bound)
+{
+    if (!_bucketCount) {
+        return;
+    }
+    const uint16_t key16 = (uint16_t)(key >> 48);
+    TTBucket* bucket = bucketFor(key);
+
+    // reuse the slot for this position if we have one, otherwise evict the shallowest, oldest entry
+    int replaceIndex = 0;
+    TTEntry replace = bucket->load(0);
+    int replaceValue = 1 << 30;
+    for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+        TTEntry candidate = bucket->load(i);
+        if (candidate.key16 == key16 || candidate.bound() == BoundNone) {
+            replaceIndex = i;
+            replace = candidate;
+            break;
+        }
+        int staleness = (_age - candidate.age()) & 63;
+        int value = candidate.depth - 8 * staleness;
+        if (value < replaceValue) {
+            replaceValue = value;
+            replaceIndex = i;
+            replace = candidate;
+        }
+    }
+
+    // keep the old best move when this search didn't find one
+    if (move == 0 && replace.key16 == key16) {
+        move = replace.move16;
+    }
+    // don't let a shallow result from the same search wipe out a deeper exact one
+    if (replace.key16 == key16 && replace.age() == _age && bound != BoundExact && depth + 2 < replace.depth) {
+        return;
+    }
+
+    TTEntry entry;
+    entry.key16 = key16;
+    entry.move16 = move;
+    entry.score = (int16_t)score;
+    entry.depth = (uint8_t)depth;
+    entry.boundAge = (uint8_t)(bound | (_age << 2));
+    bucket->save(replaceIndex, entry);
+}
+
+int TranspositionTable::hashfull() const
+{
+    if (!_bucketCount) {
+        return 0;
+    }
+    // sample the first thousand buckets, that's plenty for a permill figure
+    uint64_t samples = _bucketCount < 1000 ? _bucketCount : 1000;
+    uint64_t used = 0;
+    for (uint64_t b = 0; b < samples; b++) {
+        for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+            const TTEntry entry = _buckets[b].load(i);
+            if (entry.bound() != BoundNone && entry.age() == _age) {
+                used++;
+            }
+        }
+    }
+    return (int)(used * 1000 / (samples * TT_BUCKET_ENTRIES));
+}
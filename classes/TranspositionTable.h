@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include "GameState.h"
+
+// default budget for the chess transposition table
+constexpr int DEFAULT_HASH_MB = 16;
+
+enum TTBound {
+    BoundNone = 0,
+    BoundUpper = 1,                 // failed low, score is at most this
+    BoundLower = 2,                 // failed high, score is at least this
+    BoundExact = 3
+};
+
+// one 8 byte slot. the bucket index already uses the low bits of the key, the top 16 bits verify the hit.
+// the whole entry is read and written as a single 64-bit word so search threads can share the table without locks
+struct TTEntry {
+    uint16_t key16;
+    uint16_t move16;                // from | to << 6 | promotion << 12, zero for no move
+    int16_t score;
+    uint8_t depth;
+    uint8_t boundAge;               // bound in the low 2 bits, search age in the upper 6
+
+    int bound() const { return boundAge & 3; }
+    int age() const { return boundAge >> 2; }
+};
+static_assert(sizeof(TTEntry) == 8, "TTEntry should pack into 8 bytes");
+
+// a cache line worth of entries, a probe never touches more than one line
+constexpr int TT_BUCKET_ENTRIES = 8;
+struct alignas(64) TTBucket {
+    std::atomic<uint64_t> entries[TT_BUCKET_ENTRIES];
+
+    TTEntry load(int i) const { return std::bit_cast<TTEntry>(entries[i].load(std::memory_order_relaxed)); }
+    void save(int i, const TTEntry& entry) { entries[i].store(std::bit_cast<uint64_t>(entry), std::memory_order_relaxed); }
+};
+static_assert(sizeof(TTBucket) == 64, "TTBucket should fill exactly one cache line");
+
+// from, to and the promotion piece are enough to pick a move out of the generated list
+inline uint16_t packMove(const BitMove& move) {
+    return (uint16_t)(move.from | (move.to << 6) | ((move.flags & PromotionPieceMask) << 7));
+}
+
+inline bool isPackedMove(uint16_t packed, const BitMove& move) {
+    return packed != 0 && packed == packMove(move);
+}
+
+class TranspositionTable {
+public:
+    TranspositionTable();
+    ~TranspositionTable();
+
+    // sizes the table to the largest power of two bucket count that fits the budget, 0 turns it off
+    void resize(int megabytes);
+    void clear();
+    // bump the age so entries from older searches get replaced first
+    void newSearch() { _age = (_age + 1) & 63; }
+
+    bool enabled() const { return _bucketCount != 0; }
+    int sizeMB() const { return (int)((_bucketCount * sizeof(TTBucket)) >> 20); }
+
+    bool probe(uint64_t key, TTEntry& entry) const;
+    void store(uint64_t key, uint16_t move, int score, int depth, int bound);
+    // how full the table is with entries from the current search, in permill
+    int hashfull() const;
+
+private:
+    TTBucket* bucketFor(uint64_t key) const { return &_buckets[key & (_bucketCount - 1)]; }
+
+    TTBucket* _buckets;
+    uint64_t _bucketCount;
+    uint8_t _age;
+};
@@ -1,3 +1,5 @@
+#pragma once
+
 const int pawnTableW[64] {
     0,  0,  0,  0,  0,  0,  0,  0,
     50, 50, 50, 50, 50, 50, 50, 50,
@@ -0,0 +1,340 @@
+//
+// perft - headless move generation benchmark
+//
+// walks the GameState move generator and makeMove/unmakeMove to a fixed depth from a list of positions
+// and reports node counts, a per-move divide breakdown and nodes per second. the built in positions
+// carry their published node counts, any depth we know is checked against them.
+// builds only the engine pieces, no ImGui or GLFW.
+//
+// usage: perft [-d depth] [-q] [-l] [-c] [-s] [--sliders magic|pext] [--fen "<fen string>"]
+//   -d depth   search depth, defaults to 4
+//   -q         skip the per-move divide breakdown
+//   -l         make and unmake the leaf moves instead of bulk counting them
+//   -c         check the incremental zobrist key and score against a full recompute at every node,
+//              and that the staged generator and packed move lookup agree with the full move list
+//   -s         time the magic and pext slider lookups against each other, raw and on the perft run
+//   --sliders  force the slider attack lookup instead of the one picked from CPUID
+//   --fen      run a single position instead of the built in list
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include "classes/GameState.h"
+#include "classes/MagicBitboards.h"
+#include "classes/TranspositionTable.h"
+
+// count every heap allocation so we can see what the hot path costs per node
+static uint64_t allocationCount = 0;
+
+void* operator new(size_t size)
+{
+    allocationCount++;
+    if (void* ptr = malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+constexpr int MAX_EXPECTED_DEPTH = 6;
+
+struct PerftPosition {
+    const char* name;
+    const char* fen;
+    uint64_t expected[MAX_EXPECTED_DEPTH];  // nodes at depth 1..6, zero where we don't have a number
+};
+
+// the standard positions from the chess programming wiki perft results page
+static const PerftPosition perftPositions[] = {
+    { "startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      { 20, 400, 8902, 197281, 4865609, 119060324 } },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      { 48, 2039, 97862, 4085603, 193690690, 0 } },
+    { "position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+      { 14, 191, 2812, 43238, 674624, 11030083 } },
+    { "position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      { 6, 264, 9467, 422333, 15833292, 0 } },
+    { "position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+      { 44, 1486, 62379, 2103487, 89941194, 0 } },
+    { "position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+      { 46, 2079, 89890, 3894594, 164075551, 0 } },
+};
+
+static std::string squareName(int square)
+{
+    std::string name;
+    name += (char)('a' + (square & 7));
+    name += (char)('1' + (square >> 3));
+    return name;
+}
+
+static std::string moveName(const BitMove& move)
+{
+    std::string name = squareName(move.from) + squareName(move.to);
+    if (move.flags & IsPromotion) {
+        name += " pnbrqk"[move.promotion()];
+    }
+    return name;
+}
+
+static bool makeLeafMoves = false;
+static bool checkIncremental = false;
+
+// captures plus quiets has to be the full list, and every move has to survive a trip through the TT packing
+static void checkStagedGeneration(GameState& state, const MoveList& moves)
+{
+    GameState::MoveMasks masks;
+    state.computeMoveMasks(masks);
+    MoveList captures, quiets;
+    state.generateMoves(captures, masks, GenCaptures);
+    state.generateMoves(quiets, masks, GenQuiets);
+    if (captures.size() + quiets.size() != moves.size()) {
+        printf("staged generation found %d captures and %d quiets, the full list has %d moves\n",
+               captures.size(), quiets.size(), moves.size());
+        exit(1);
+    }
+    for (const auto& move : moves) {
+        BitMove unpacked;
+        if (!state.moveFromPacked(packMove(move), masks, unpacked) || !(unpacked == move)) {
+            printf("packed move %s did not come back\n", moveName(move).c_str());
+            exit(1);
+        }
+    }
+}
+
+// templated on the side to move like the search, so the generator and make/unmake run without color branches
+template <int Color>
+static uint64_t perft(GameState& state, int depth)
+{
+    if (checkIncremental && state.hash() != state.computeHash()) {
+        printf("incremental zobrist key %016llx does not match recomputed %016llx\n",
+               (unsigned long long)state.hash(), (unsigned long long)state.computeHash());
+        exit(1);
+    }
+    if (checkIncremental && state.score() != state.computeScore()) {
+        printf("incremental score %d does not match recomputed %d\n", state.score(), state.computeScore());
+        exit(1);
+    }
+    if (depth == 0) {
+        return 1;
+    }
+    MoveList moves;
+    GameState::MoveMasks masks;
+    state.computeMoveMasks<Color>(masks);
+    state.generateMoves<Color>(moves, masks, GenAll);
+    if (checkIncremental) {
+        checkStagedGeneration(state, moves);
+    }
+    // bulk count the leaves, the generator only returns legal moves
+    if (depth == 1 && !makeLeafMoves) {
+        return moves.size();
+    }
+    uint64_t nodes = 0;
+    for (const auto& move : moves) {
+        state.makeMove<Color>(move);
+        nodes += perft<-Color>(state, depth - 1);
+        state.unmakeMove<Color>(move);
+    }
+    return nodes;
+}
+
+static bool mismatch = false;
+
+static uint64_t runPosition(const PerftPosition& position, int depth, bool divide)
+{
+    GameState state;
+    if (!state.initFromFEN(position.fen)) {
+        printf("%s: could not parse FEN \"%s\"\n", position.name, position.fen);
+        return 0;
+    }
+
+    printf("\n%s: %s\n", position.name, position.fen);
+
+    uint64_t startAllocations = allocationCount;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = 0;
+    MoveList moves;
+    state.generateAllMoves(moves);
+    for (const auto& move : moves) {
+        state.makeMove(move);
+        uint64_t moveNodes = state.color == WHITE ? perft<WHITE>(state, depth - 1) : perft<BLACK>(state, depth - 1);
+        state.unmakeMove(move);
+        if (divide) {
+            printf("  %-6s %llu\n", moveName(move).c_str(), (unsigned long long)moveNodes);
+        }
+        nodes += moveNodes;
+    }
+    auto end = std::chrono::steady_clock::now();
+    uint64_t allocations = allocationCount - startAllocations;
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double nps = seconds > 0.0 ? nodes / seconds : 0.0;
+    printf("  depth %d: %llu nodes, %d moves, %.3f s, %.0f nps, %llu allocations\n", depth, (unsigned long long)nodes, (int)moves.size(), seconds, nps, (unsigned long long)allocations);
+    uint64_t expected = depth <= MAX_EXPECTED_DEPTH ? position.expected[depth - 1] : 0;
+    if (expected) {
+        printf("  %s, expected %llu\n", nodes == expected ? "ok" : "MISMATCH", (unsigned long long)expected);
+        mismatch |= nodes != expected;
+    }
+    return nodes;
+}
+
+// rook and bishop lookups from every square over a fixed set of random occupancies, returns lookups per second
+static double timeSliderLookups()
+{
+    std::vector<uint64_t> occupancies(4096);
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    for (auto& occupancy : occupancies) {
+        // three xorshift draws and'ed together, about as crowded as a middlegame board
+        uint64_t bits = ~0ULL;
+        for (int i = 0; i < 3; i++) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            bits &= seed;
+        }
+        occupancy = bits;
+    }
+
+    uint64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < 16; pass++) {
+        for (uint64_t occupancy : occupancies) {
+            for (int square = 0; square < 64; square++) {
+                sink ^= getRookAttacks(square, occupancy) + getBishopAttacks(square, occupancy);
+            }
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    // keep the loop from being thrown away
+    if (sink == 1) {
+        printf("\n");
+    }
+    double seconds = std::chrono::duration<double>(end - start).count();
+    return seconds > 0.0 ? 16.0 * occupancies.size() * 64 * 2 / seconds : 0.0;
+}
+
+// --sliders, false if the name isn't known or this CPU can't run pext
+static bool forceSliderBackend(const char* name)
+{
+    if (strcmp(name, "magic") == 0) {
+        return setSliderBackend(SliderMagic);
+    }
+    if (strcmp(name, "pext") == 0 && setSliderBackend(SliderPext)) {
+        return true;
+    }
+    printf("can't use \"%s\" sliders here, pick magic or pext on a CPU with bmi2\n", name);
+    return false;
+}
+
+static int compareSliderBackends(const std::vector<PerftPosition>& positions, int depth)
+{
+    const SliderBackend startBackend = sliderBackend;
+    const SliderBackend backends[] = { SliderMagic, SliderPext };
+    const char* names[] = { "magic", "pext" };
+    double lookups[2] = {}, seconds[2] = {};
+    uint64_t nodes[2] = {};
+
+    for (int b = 0; b < 2; b++) {
+        if (!setSliderBackend(backends[b])) {
+            printf("\n%s: not supported on this cpu\n", names[b]);
+            continue;
+        }
+        printf("\nslider backend: %s\n", names[b]);
+        lookups[b] = timeSliderLookups();
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& position : positions) {
+            nodes[b] += runPosition(position, depth, false);
+        }
+        auto end = std::chrono::steady_clock::now();
+        seconds[b] = std::chrono::duration<double>(end - start).count();
+    }
+    setSliderBackend(startBackend);
+
+    printf("\n");
+    for (int b = 0; b < 2; b++) {
+        if (seconds[b] > 0.0) {
+            printf("%-6s %8.1f M lookups/s  perft %llu nodes, %.3f s, %.0f nps\n", names[b], lookups[b] / 1e6,
+                   (unsigned long long)nodes[b], seconds[b], nodes[b] / seconds[b]);
+        }
+    }
+    printf("default on this cpu: %s\n", names[startBackend]);
+    return mismatch ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+    int depth = 4;
+    bool divide = true;
+    bool compareSliders = false;
+    const char* fen = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0) {
+            divide = false;
+        } else if (strcmp(argv[i], "-l") == 0) {
+            makeLeafMoves = true;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            checkIncremental = true;
+        } else if (strcmp(argv[i], "-s") == 0) {
+            compareSliders = true;
+        } else if (strcmp(argv[i], "--sliders") == 0 && i + 1 < argc) {
+            if (!forceSliderBackend(argv[++i])) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--fen") == 0 && i + 1 < argc) {
+            fen = argv[++i];
+        } else {
+            printf("usage: %s [-d depth] [-q] [-l] [-c] [-s] [--sliders magic|pext] [--fen \"<fen string>\"]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (depth < 1 || depth > MAX_DEPTH) {
+        printf("depth must be between 1 and %d\n", MAX_DEPTH);
+        return 1;
+    }
+
+#if defined(CHESS_COPY_MAKE)
+    printf("make/unmake: copy-make\n");
+#else
+    printf("make/unmake: undo records\n");
+#endif
+    printf("sliders: %s\n", sliderBackend == SliderPext ? "pext" : "magic");
+
+    std::vector<PerftPosition> positions;
+    if (fen) {
+        positions.push_back({ "fen", fen, {} });
+    } else {
+        positions.assign(std::begin(perftPositions), std::end(perftPositions));
+    }
+    if (compareSliders) {
+        return compareSliderBackends(positions, depth);
+    }
+
+    uint64_t totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& position : positions) {
+        totalNodes += runPosition(position, depth, divide);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    printf("\ntotal: %llu nodes, %.3f s, %.0f nps\n", (unsigned long long)totalNodes, seconds, seconds > 0.0 ? totalNodes / seconds : 0.0);
+
+    return mismatch ? 1 : 0;
+}